@@ -8,17 +8,64 @@
 #include "abstractindexer.h"
 #include <TextUtils/ConvertText>
 
+#include <Akonadi/Collection>
+
+#include <xapian.h>
+
+#include <string_view>
+#include <vector>
+
+namespace
+{
+constexpr char AncestorPrefix[] = "XCA:";
+constexpr char ResourcePrefix[] = "XCR:";
+
+bool hasTerm(const Xapian::Document &doc, const std::string &term)
+{
+    Xapian::TermIterator it = doc.termlist_begin();
+    it.skip_to(term);
+    return it != doc.termlist_end() && *it == term;
+}
+
+void removeTermsWithPrefix(Xapian::Document &doc, std::string_view prefix)
+{
+    // Don't modify the termlist while iterating over it
+    std::vector<std::string> terms;
+    Xapian::TermIterator it = doc.termlist_begin();
+    it.skip_to(std::string(prefix));
+    for (; it != doc.termlist_end() && std::string_view(*it).starts_with(prefix); ++it) {
+        terms.push_back(*it);
+    }
+    for (const std::string &term : terms) {
+        doc.remove_term(term);
+    }
+}
+}
+
 AbstractIndexer::AbstractIndexer() = default;
 
 AbstractIndexer::~AbstractIndexer() = default;
 
-void AbstractIndexer::move(Akonadi::Item::Id item, Akonadi::Collection::Id from, Akonadi::Collection::Id to)
+void AbstractIndexer::index(const Akonadi::Item &item, IndexingTier tier)
+{
+    Q_UNUSED(tier)
+    index(item);
+}
+
+void AbstractIndexer::move(Akonadi::Item::Id item, const Akonadi::Collection &from, const Akonadi::Collection &to)
 {
     Q_UNUSED(item)
     Q_UNUSED(from)
     Q_UNUSED(to)
 }
 
+void AbstractIndexer::move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to)
+{
+    Q_UNUSED(collection)
+    Q_UNUSED(from)
+    Q_UNUSED(to)
+}
+
 void AbstractIndexer::updateFlags(const Akonadi::Item &item, const QSet<QByteArray> &addedFlags, const QSet<QByteArray> &removed)
 {
     Q_UNUSED(item)
@@ -26,6 +73,64 @@ void AbstractIndexer::updateFlags(const Akonadi::Item &item, const QSet<QByteArr
     Q_UNUSED(removed)
 }
 
+void AbstractIndexer::updateTags(const Akonadi::Item &item, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags)
+{
+    Q_UNUSED(item)
+    Q_UNUSED(addedTags)
+    Q_UNUSED(removedTags)
+}
+
+void AbstractIndexer::removeTag(const Akonadi::Tag &tag)
+{
+    Q_UNUSED(tag)
+}
+
+QByteArrayList AbstractIndexer::ancestorTerms(const Akonadi::Collection &collection)
+{
+    QByteArrayList terms;
+    QString resource;
+    for (Akonadi::Collection col = collection; col.isValid() && col.id() != Akonadi::Collection::root().id(); col = col.parentCollection()) {
+        terms << AncestorPrefix + QByteArray::number(col.id());
+        // Only the collections fetched by the agent itself know their resource
+        if (resource.isEmpty()) {
+            resource = col.resource();
+        }
+    }
+    if (!resource.isEmpty()) {
+        terms << ResourcePrefix + resource.toUtf8();
+    }
+    return terms;
+}
+
+void AbstractIndexer::setAncestorTerms(Xapian::Document &doc, const Akonadi::Collection &collection)
+{
+    removeTermsWithPrefix(doc, AncestorPrefix);
+    removeTermsWithPrefix(doc, ResourcePrefix);
+    const QByteArrayList terms = ancestorTerms(collection);
+    for (const QByteArray &term : terms) {
+        doc.add_boolean_term(term.toStdString());
+    }
+}
+
+void AbstractIndexer::moveAncestorTerms(Xapian::Document &doc, const Akonadi::Collection &from, const Akonadi::Collection &to)
+{
+    // The ancestors below the moved collection did not change
+    const QByteArrayList fromTerms = ancestorTerms(from);
+    const QByteArrayList toTerms = ancestorTerms(to);
+    if (!toTerms.isEmpty() && toTerms.last().startsWith(ResourcePrefix)) {
+        removeTermsWithPrefix(doc, ResourcePrefix);
+    }
+    for (const QByteArray &term : fromTerms) {
+        const std::string t = term.toStdString();
+        if (!toTerms.contains(term) && hasTerm(doc, t)) {
+            doc.remove_term(t);
+        }
+    }
+    for (const QByteArray &term : toTerms) {
+        doc.add_boolean_term(term.toStdString());
+    }
+}
+
 bool AbstractIndexer::respectDiacriticAndAccents() const
 {
     return mRespectDiacriticAndAccents;
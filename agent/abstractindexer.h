@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include "indexingpolicy.h"
+
 #include <Akonadi/Item>
+#include <Akonadi/Tag>
+#include <QByteArrayList>
 #include <QStringList>
 
 namespace Akonadi
@@ -15,6 +19,11 @@ namespace Akonadi
 class Collection;
 }
 
+namespace Xapian
+{
+class Document;
+}
+
 class AbstractIndexer
 {
 public:
@@ -23,12 +32,35 @@ public:
 
     virtual QStringList mimeTypes() const = 0;
     virtual void index(const Akonadi::Item &item) = 0;
+    /**
+     * Index @p item at the given @p tier. The default implementation
+     * ignores the tier and indexes the item fully.
+     */
+    virtual void index(const Akonadi::Item &item, IndexingTier tier);
     virtual void remove(const Akonadi::Item &item) = 0;
     virtual void remove(const Akonadi::Collection &item) = 0;
     virtual void commit() = 0;
 
-    virtual void move(Akonadi::Item::Id item, Akonadi::Collection::Id from, Akonadi::Collection::Id to);
+    virtual void move(Akonadi::Item::Id item, const Akonadi::Collection &from, const Akonadi::Collection &to);
+    /**
+     * @p collection moved from @p from to @p to, update the ancestor terms
+     * of the items of its subtree. The default implementation does nothing.
+     */
+    virtual void move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to);
     virtual void updateFlags(const Akonadi::Item &item, const QSet<QByteArray> &addedFlags, const QSet<QByteArray> &removed);
+    virtual void updateTags(const Akonadi::Item &item, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags);
+    virtual void removeTag(const Akonadi::Tag &tag);
+
+    /**
+     * The boolean terms locating an item of @p collection: "XCA:" + id for the
+     * collection and each of its ancestors, so that a single term matches a
+     * whole subtree, and "XCR:" + identifier for its resource when known.
+     */
+    [[nodiscard]] static QByteArrayList ancestorTerms(const Akonadi::Collection &collection);
+    /// Replaces the ancestor terms of @p doc by the ones of @p collection
+    static void setAncestorTerms(Xapian::Document &doc, const Akonadi::Collection &collection);
+    /// Moves @p doc, in a subtree whose root moved from below @p from to below @p to
+    static void moveAncestorTerms(Xapian::Document &doc, const Akonadi::Collection &from, const Akonadi::Collection &to);
 
     [[nodiscard]] bool respectDiacriticAndAccents() const;
     void setRespectDiacriticAndAccents(bool newRespectDiacriticAndAccents);
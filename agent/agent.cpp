@@ -14,6 +14,7 @@
 #include "contactindexer.h"
 #include "emailindexer.h"
 #include "indexeradaptor.h"
+#include "indexingtierattribute.h"
 
 #include "priority.h"
 
@@ -23,6 +24,7 @@
 #include <Akonadi/EntityDisplayAttribute>
 #include <Akonadi/IndexPolicyAttribute>
 #include <Akonadi/ItemFetchScope>
+#include <Akonadi/TagFetchScope>
 
 #include <Akonadi/AgentManager>
 #include <Akonadi/ServerManager>
@@ -32,7 +34,7 @@
 #include <KConfigGroup>
 #include <KLocalizedString>
 
-#define INDEXING_AGENT_VERSION 5
+#define INDEXING_AGENT_VERSION 13
 
 using namespace Qt::Literals::StringLiterals;
 AkonadiIndexingAgent::AkonadiIndexingAgent(const QString &id)
@@ -44,6 +46,7 @@ AkonadiIndexingAgent::AkonadiIndexingAgent(const QString &id)
     lowerPriority();
 
     Akonadi::AttributeFactory::registerAttribute<Akonadi::IndexPolicyAttribute>();
+    Akonadi::AttributeFactory::registerAttribute<IndexingTierAttribute>();
 
     KConfigGroup cfg = config()->group(u"General"_s);
     const int agentIndexingVersion = cfg.readEntry("agentIndexingVersion", 0);
@@ -58,6 +61,9 @@ AkonadiIndexingAgent::AkonadiIndexingAgent(const QString &id)
         cfg.sync();
     }
     m_index.setRespectDiacriticAndAccents(respectDiacriticAndAccents);
+    IndexingPolicy policy;
+    policy.load(cfg);
+    m_index.setIndexingPolicy(policy);
     if (!m_index.createIndexers()) {
         Q_EMIT status(Broken, i18nc("@info:status", "No indexers available"));
         setOnline(false);
@@ -77,7 +83,10 @@ AkonadiIndexingAgent::AkonadiIndexingAgent(const QString &id)
     changeRecorder()->itemFetchScope().setFetchRemoteIdentification(false);
     changeRecorder()->itemFetchScope().setFetchModificationTime(false);
     changeRecorder()->itemFetchScope().fetchFullPayload(true);
+    changeRecorder()->itemFetchScope().setFetchTags(true);
+    changeRecorder()->itemFetchScope().tagFetchScope().setFetchIdOnly(true);
     changeRecorder()->collectionFetchScope().fetchAttribute<Akonadi::IndexPolicyAttribute>();
+    changeRecorder()->collectionFetchScope().fetchAttribute<IndexingTierAttribute>();
     changeRecorder()->collectionFetchScope().setAncestorRetrieval(Akonadi::CollectionFetchScope::All);
     changeRecorder()->collectionFetchScope().ancestorFetchScope().fetchAttribute<Akonadi::EntityDisplayAttribute>();
     changeRecorder()->collectionFetchScope().setListFilter(Akonadi::CollectionFetchScope::Index);
@@ -178,6 +187,19 @@ void AkonadiIndexingAgent::itemsFlagsChanged(const Akonadi::Item::List &items, c
     m_index.scheduleCommit();
 }
 
+void AkonadiIndexingAgent::itemsTagsChanged(const Akonadi::Item::List &items, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags)
+{
+    // Same as for flags, only the tag terms change so don't reindex the items
+    m_index.updateTags(items, addedTags, removedTags);
+    m_index.scheduleCommit();
+}
+
+void AkonadiIndexingAgent::tagRemoved(const Akonadi::Tag &tag)
+{
+    m_index.removeTag(tag);
+    m_index.scheduleCommit();
+}
+
 void AkonadiIndexingAgent::itemsRemoved(const Akonadi::Item::List &items)
 {
     // We optimize and skip the "shouldIndex" call for each item here, since it's
@@ -238,6 +260,12 @@ void AkonadiIndexingAgent::collectionChanged(const Akonadi::Collection &collecti
         }
     }
 
+    if (changedAttributes.contains(IndexingTierAttribute().type()) && shouldIndex(collection)) {
+        // Already indexed items keep their old tier otherwise
+        m_index.remove(collection);
+        m_scheduler.scheduleCollection(collection, true);
+    }
+
     QSet<QByteArray> changes = changedAttributes;
     changes.remove("collectionquota");
     changes.remove("timestamp");
@@ -270,14 +298,13 @@ void AkonadiIndexingAgent::collectionMoved(const Akonadi::Collection &collection
                                            const Akonadi::Collection &collectionSource,
                                            const Akonadi::Collection &collectionDestination)
 {
-    Q_UNUSED(collectionSource)
-    Q_UNUSED(collectionDestination)
-
     if (!shouldIndex(collection)) {
         return;
     }
 
-    m_index.remove(collection);
+    // Only the ancestors above the moved collection change, its items stay indexed
+    m_index.move(collection, collectionSource, collectionDestination);
+    m_index.scheduleCommit();
     auto job = new CollectionUpdateJob(m_index, collection, this);
     job->start();
 }
@@ -293,6 +320,21 @@ int AkonadiIndexingAgent::numberOfCollectionQueued()
     return m_scheduler.numberOfCollectionQueued();
 }
 
+QList<qlonglong> AkonadiIndexingAgent::quarantinedItems() const
+{
+    return m_index.quarantinedItems().keys();
+}
+
+QString AkonadiIndexingAgent::quarantineReason(const qlonglong id) const
+{
+    return m_index.quarantinedItems().value(id);
+}
+
+QString AkonadiIndexingAgent::attachmentStatistics() const
+{
+    return m_index.attachmentStatistics();
+}
+
 void AkonadiIndexingAgent::onAbortRequested()
 {
     KConfigGroup group = config()->group(u"General"_s);
@@ -18,11 +18,11 @@ using namespace Qt::Literals::StringLiterals;
 #include "scheduler.h"
 #include <QList>
 
-class AkonadiIndexingAgent : public Akonadi::AgentBase, public Akonadi::AgentBase::ObserverV3
+class AkonadiIndexingAgent : public Akonadi::AgentBase, public Akonadi::AgentBase::ObserverV4
 {
     Q_OBJECT
 public:
-    using Akonadi::AgentBase::ObserverV3::collectionChanged; // So we don't trigger -Woverloaded-virtual
+    using Akonadi::AgentBase::ObserverV4::collectionChanged; // So we don't trigger -Woverloaded-virtual
     explicit AkonadiIndexingAgent(const QString &id);
     ~AkonadiIndexingAgent() override;
 
@@ -31,11 +31,16 @@ public:
     void reindexCollections(const QList<qlonglong> &ids);
     [[nodiscard]] qlonglong indexedItems(const qlonglong id);
     [[nodiscard]] int numberOfCollectionQueued();
+    [[nodiscard]] QList<qlonglong> quarantinedItems() const;
+    [[nodiscard]] QString quarantineReason(const qlonglong id) const;
+    [[nodiscard]] QString attachmentStatistics() const;
 
     void itemAdded(const Akonadi::Item &item, const Akonadi::Collection &collection) override;
     void itemChanged(const Akonadi::Item &item, const QSet<QByteArray> &partIdentifiers) override;
     void itemsFlagsChanged(const Akonadi::Item::List &items, const QSet<QByteArray> &addedFlags, const QSet<QByteArray> &removedFlags) override;
+    void itemsTagsChanged(const Akonadi::Item::List &items, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags) override;
     void itemsRemoved(const Akonadi::Item::List &items) override;
+    void tagRemoved(const Akonadi::Tag &tag) override;
     void itemsMoved(const Akonadi::Item::List &items, const Akonadi::Collection &sourceCollection, const Akonadi::Collection &destinationCollection) override;
 
     void collectionAdded(const Akonadi::Collection &collection, const Akonadi::Collection &parent) override;
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include "attachmentextractor.h"
+using namespace Qt::Literals::StringLiterals;
+
+#include <KCodecs>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QStringDecoder>
+
+#include <algorithm>
+
+AttachmentExtractor::AttachmentExtractor(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(2);
+}
+
+AttachmentExtractor::~AttachmentExtractor()
+{
+    m_pool.waitForDone();
+}
+
+void AttachmentExtractor::setMaxThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(std::max(count, 1));
+}
+
+void AttachmentExtractor::extract(Akonadi::Item::Id id, quint64 generation, const QList<Attachment> &attachments)
+{
+    m_pool.start([this, id, generation, attachments]() {
+        Result result = run(id, generation, attachments);
+        {
+            QMutexLocker lock(&m_mutex);
+            m_results.push_back(std::move(result));
+        }
+        Q_EMIT resultsReady();
+    });
+}
+
+AttachmentExtractor::Result AttachmentExtractor::run(Akonadi::Item::Id id, quint64 generation, const QList<Attachment> &attachments)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Everything Xapian stays local to this thread, only plain strings leave it
+    Xapian::Document doc;
+    Xapian::TermGenerator termGen;
+    termGen.set_document(doc);
+
+    qint64 bytes = 0;
+    for (const Attachment &attachment : attachments) {
+        QByteArray data = attachment.data;
+        if (const KCodecs::Codec *codec = attachment.encoding.isEmpty() ? nullptr : KCodecs::Codec::codecForName(attachment.encoding)) {
+            data = codec->decode(data);
+        }
+        data.truncate(attachment.limit);
+
+        QStringDecoder decoder(attachment.charset.isEmpty() ? "UTF-8" : attachment.charset.constData());
+        if (!decoder.isValid()) {
+            decoder = QStringDecoder(QStringDecoder::Utf8);
+        }
+        const QString text = decoder(data);
+        termGen.index_text_without_positions(text.toStdString(), 1, "AT");
+        bytes += data.size();
+    }
+
+    Result result;
+    result.id = id;
+    result.generation = generation;
+    result.terms.reserve(doc.termlist_count());
+    for (auto it = doc.termlist_begin(), end = doc.termlist_end(); it != end; ++it) {
+        result.terms.emplace_back(*it, it.get_wdf());
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_attachmentCount += attachments.count();
+    m_byteCount += bytes;
+    m_termCount += result.terms.size();
+    m_elapsedUs += timer.nsecsElapsed() / 1000;
+    return result;
+}
+
+std::vector<AttachmentExtractor::Result> AttachmentExtractor::takeResults()
+{
+    QMutexLocker lock(&m_mutex);
+    return std::exchange(m_results, {});
+}
+
+void AttachmentExtractor::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+QString AttachmentExtractor::statistics() const
+{
+    QMutexLocker lock(&m_mutex);
+    const double seconds = m_elapsedUs / 1000000.0;
+    const double throughput = seconds > 0 ? m_byteCount / 1024.0 / seconds : 0;
+    return u"%1 attachments, %2 bytes, %3 terms in %4 ms (%5 KiB/s)"_s.arg(m_attachmentCount)
+        .arg(m_byteCount)
+        .arg(m_termCount)
+        .arg(m_elapsedUs / 1000)
+        .arg(throughput, 0, 'f', 1);
+}
+
+#include "moc_attachmentextractor.cpp"
@@ -0,0 +1,78 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <Akonadi/Item>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+
+#include <xapian.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Extracts the text of text-like attachments on a small thread pool.
+ *
+ * The email indexer queues the still encoded attachments of an item, which
+ * are decoded and size limited here, and picks up the resulting terms with
+ * takeResults() when it commits, so it never waits for an extraction to finish.
+ *
+ * Each extraction carries the generation of the item it was queued for, so
+ * results of an item indexed again in the meantime can be told apart.
+ */
+class AttachmentExtractor : public QObject
+{
+    Q_OBJECT
+public:
+    struct Attachment {
+        // Body as found in the message, in its transfer encoding
+        QByteArray data;
+        // "base64", "quoted-printable" or "x-uuencode", empty when not encoded
+        QByteArray encoding;
+        QByteArray charset;
+        // Decoded bytes to extract at most
+        qint64 limit = 0;
+    };
+
+    struct Result {
+        Akonadi::Item::Id id = -1;
+        quint64 generation = 0;
+        std::vector<std::pair<std::string, Xapian::termcount>> terms;
+    };
+
+    explicit AttachmentExtractor(QObject *parent = nullptr);
+    ~AttachmentExtractor() override;
+
+    void setMaxThreadCount(int count);
+
+    void extract(Akonadi::Item::Id id, quint64 generation, const QList<Attachment> &attachments);
+    [[nodiscard]] std::vector<Result> takeResults();
+
+    /// Blocks until all queued extractions are done. For shutdown and testing.
+    void waitForDone();
+
+    [[nodiscard]] QString statistics() const;
+
+Q_SIGNALS:
+    void resultsReady();
+
+private:
+    [[nodiscard]] Result run(Akonadi::Item::Id id, quint64 generation, const QList<Attachment> &attachments);
+
+    QThreadPool m_pool;
+    mutable QMutex m_mutex;
+    std::vector<Result> m_results;
+    qint64 m_attachmentCount = 0;
+    qint64 m_byteCount = 0;
+    qint64 m_termCount = 0;
+    qint64 m_elapsedUs = 0;
+};
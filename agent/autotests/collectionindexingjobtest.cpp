@@ -37,7 +37,7 @@ public:
         indexed = QSet<Akonadi::Item::Id>(alreadyIndexed.begin(), alreadyIndexed.end());
     }
 
-    void index(const Akonadi::Item &item) override
+    void index(const Akonadi::Item &item, IndexingTier /* tier */) override
     {
         itemsIndexed << item.id();
     }
@@ -207,6 +207,48 @@ private Q_SLOTS:
             QCOMPARE(results.at(0), col3.id());
         }
     }
+
+    void subtrees()
+    {
+        Akonadi::Collection col1(1);
+        col1.setName(u"col1"_s);
+        index.index(col1);
+
+        Akonadi::Collection col2(2);
+        col2.setName(u"col2"_s);
+        col2.setParentCollection(col1);
+        index.index(col2);
+
+        Akonadi::Collection col3(3);
+        col3.setName(u"col3"_s);
+        col3.setParentCollection(col2);
+        index.index(col3);
+
+        Akonadi::Collection col4(4);
+        col4.setName(u"col4"_s);
+        col4.setParentCollection(col1);
+        index.index(col4);
+
+        Akonadi::Search::PIM::CollectionQuery query;
+        query.setDatabaseDir(dbPrefix + "/collections/"_L1);
+
+        // The whole tree
+        auto subtrees = query.subtrees({3, 1, 2, 4});
+        QCOMPARE(subtrees.roots, QList<Akonadi::Collection::Id>({1}));
+        QVERIFY(subtrees.collections.isEmpty());
+        QCOMPARE(subtrees.members.value(1), QList<Akonadi::Collection::Id>({3, 2, 4}));
+
+        // col4 is missing
+        subtrees = query.subtrees({1, 2, 3});
+        QCOMPARE(subtrees.roots, QList<Akonadi::Collection::Id>({2}));
+        QCOMPARE(subtrees.collections, QList<Akonadi::Collection::Id>({1}));
+        QCOMPARE(subtrees.members.value(2), QList<Akonadi::Collection::Id>({3}));
+
+        // Leaves and unknown collections are kept as they are
+        subtrees = query.subtrees({3, 4, 42});
+        QVERIFY(subtrees.roots.isEmpty());
+        QCOMPARE(subtrees.collections, QList<Akonadi::Collection::Id>({3, 4, 42}));
+    }
 };
 
 QTEST_GUILESS_MAIN(CollectionQueryTest)
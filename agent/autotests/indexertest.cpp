@@ -7,18 +7,32 @@
  */
 
 #include <Akonadi/Collection>
+#include <KContacts/Addressee>
 using namespace Qt::Literals::StringLiterals;
 
 #include <QDir>
+#include <QSemaphore>
+#include <QStandardPaths>
 #include <QTest>
+#include <QThreadPool>
+#include <QTimeZone>
+
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "../search/calendar/calendarsearchstore.h"
 #include "../search/contact/contactsearchstore.h"
 #include "../search/email/emailsearchstore.h"
 #include "calendarindexer.h"
 #include "contactindexer.h"
+#include "contactrecord.h"
 #include "emailindexer.h"
+#include "lib/contactcompleter.h"
+#include "lib/contactquery.h"
+#include "lib/resultiterator.h"
 #include "query.h"
+#include "search/email/contactchanges.h"
 
 Q_DECLARE_METATYPE(QSet<qint64>)
 Q_DECLARE_METATYPE(QList<qint64>)
@@ -44,6 +58,8 @@ private:
     QString contactsDir;
     QString calendarsDir;
     QString notesDir;
+    // Read by the completion index of the process, kept for all the tests
+    QString completionContactsDir;
 
     bool removeDir(const QString &dirName)
     {
@@ -68,12 +84,64 @@ private:
         return result;
     }
 
+    static QSet<qint64> resultIds(Akonadi::Search::PIM::ResultIterator it)
+    {
+        QSet<qint64> ids;
+        while (it.next()) {
+            ids << it.id();
+        }
+        return ids;
+    }
+
+    static Akonadi::Item contactItem(Akonadi::Item::Id id, const QString &name)
+    {
+        KContacts::Addressee addressee;
+        addressee.setFormattedName(name);
+
+        Akonadi::Item item(KContacts::Addressee::mimeType());
+        item.setId(id);
+        item.setPayload(addressee);
+        item.setParentCollection(Akonadi::Collection(1));
+        return item;
+    }
+
+    static Akonadi::Item messageFrom(Akonadi::Item::Id id, const char *from)
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->from()->from7BitString(from);
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(id);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+        return item;
+    }
+
+    static QStringList completions(const QString &prefix)
+    {
+        QStringList list = Akonadi::Search::PIM::ContactCompleter(prefix).complete();
+        list.sort();
+        return list;
+    }
+
 private Q_SLOTS:
+    void initTestCase()
+    {
+        // The contact queries read the databases of the default locations
+        QStandardPaths::setTestModeEnabled(true);
+
+        completionContactsDir = Akonadi::Search::PIM::Query::defaultLocation(u"emailContacts"_s);
+        removeDir(completionContactsDir);
+        QVERIFY(QDir().mkpath(completionContactsDir));
+    }
+
     void init()
     {
         emailDir = QDir::tempPath() + "/searchplugintest/email/"_L1;
         emailContactsDir = QDir::tempPath() + "/searchplugintest/emailcontacts/"_L1;
-        contactsDir = QDir::tempPath() + "/searchplugintest/contacts/"_L1;
+        contactsDir = Akonadi::Search::PIM::Query::defaultLocation(u"contacts"_s);
         notesDir = QDir::tempPath() + u"/searchplugintest/notes/"_s;
         calendarsDir = QDir::tempPath() + u"/searchplugintest/calendars/"_s;
 
@@ -127,6 +195,23 @@ private Q_SLOTS:
         return resultSet;
     }
 
+    QSet<qint64> searchEmails(const QString &property, const QString &value)
+    {
+        QSet<qint64> resultSet;
+
+        Akonadi::Search::Query query(Akonadi::Search::Term(property, value, Akonadi::Search::Term::Contains));
+        query.setType(u"Email"_s);
+
+        auto emailSearchStore = new Akonadi::Search::EmailSearchStore(this);
+        emailSearchStore->setDbPath(emailDir);
+        int res = emailSearchStore->exec(query);
+        while (emailSearchStore->next(res)) {
+            const int fid = Akonadi::Search::deserialize("akonadi", emailSearchStore->id(res));
+            resultSet << fid;
+        }
+        return resultSet;
+    }
+
     QSet<qint64> getAllCalendarItems()
     {
         QSet<qint64> resultSet;
@@ -196,6 +281,814 @@ private Q_SLOTS:
         QCOMPARE(getAllEmailItems(), QSet<qint64>() << 1);
     }
 
+    void testHeadersOnlyTier()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->setBody("body1");
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item, IndexingTier::HeadersOnly);
+        emailIndexer.commit();
+        QCOMPARE(getAllEmailItems(), QSet<qint64>() << 1);
+
+        QCOMPARE(searchEmails(u"subject"_s, u"subject1"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"body"_s, u"body1"_s), QSet<qint64>());
+    }
+
+    void testAttachmentBodyIsSkipped()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->contentType()->setMimeType("multipart/mixed");
+        msg->contentType()->setBoundary(KMime::multiPartBoundary());
+
+        auto text = new KMime::Content;
+        text->contentType()->setMimeType("text/plain");
+        text->setBody("body1");
+        msg->appendContent(text);
+
+        auto attachment = new KMime::Content;
+        attachment->contentType()->setMimeType("text/plain");
+        attachment->contentDisposition()->setDisposition(KMime::Headers::CDattachment);
+        attachment->contentDisposition()->setFilename(u"notes.txt"_s);
+        attachment->setBody("attachmentword");
+        msg->appendContent(attachment);
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item);
+        emailIndexer.commit();
+
+        QCOMPARE(searchEmails(u"body"_s, u"body1"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"body"_s, u"attachmentword"_s), QSet<qint64>());
+    }
+
+    void testAttachmentStage()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->contentType()->setMimeType("multipart/mixed");
+        msg->contentType()->setBoundary(KMime::multiPartBoundary());
+
+        auto text = new KMime::Content;
+        text->contentType()->setMimeType("text/plain");
+        text->setBody("body1");
+        msg->appendContent(text);
+
+        auto attachment = new KMime::Content;
+        attachment->contentType()->setMimeType("text/csv");
+        attachment->contentDisposition()->setDisposition(KMime::Headers::CDattachment);
+        attachment->contentDisposition()->setFilename(u"invoices.csv"_s);
+        attachment->setBody("attachmentword,42");
+        msg->appendContent(attachment);
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item);
+        emailIndexer.attachmentExtractor()->waitForDone();
+        emailIndexer.commit();
+
+        QCOMPARE(searchEmails(u"attachmentname"_s, u"invoices"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"attachmenttype"_s, u"text/csv"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"attachment"_s, u"attachmentword"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"body"_s, u"attachmentword"_s), QSet<qint64>());
+    }
+
+    void testStaleAttachmentResults()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->contentType()->setMimeType("multipart/mixed");
+        msg->contentType()->setBoundary(KMime::multiPartBoundary());
+
+        auto text = new KMime::Content;
+        text->contentType()->setMimeType("text/plain");
+        text->setBody("body1");
+        msg->appendContent(text);
+
+        auto attachment = new KMime::Content;
+        attachment->setContent(
+            "Content-Type: text/plain\n"
+            "Content-Disposition: attachment\n"
+            "Content-Transfer-Encoding: base64\n"
+            "\n"
+            + QByteArray("attachmentword").toBase64() + '\n');
+        attachment->parse();
+        msg->appendContent(attachment);
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        auto changedMsg = std::make_shared<KMime::Message>();
+        changedMsg->subject()->from7BitString("subject2");
+        changedMsg->setBody("body2");
+        changedMsg->assemble();
+
+        Akonadi::Item changedItem(KMime::Message::mimeType());
+        changedItem.setId(1);
+        changedItem.setPayload(changedMsg);
+        changedItem.setParentCollection(Akonadi::Collection(1));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item);
+        emailIndexer.attachmentExtractor()->waitForDone();
+        emailIndexer.commit();
+        // Decoded by the extractor
+        QCOMPARE(searchEmails(u"attachment"_s, u"attachmentword"_s), QSet<qint64>() << 1);
+
+        // The extraction of the previous version must not end up in the new one
+        emailIndexer.index(item);
+        emailIndexer.index(changedItem);
+        emailIndexer.attachmentExtractor()->waitForDone();
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"subject"_s, u"subject2"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"attachment"_s, u"attachmentword"_s), QSet<qint64>());
+    }
+
+    void testPhraseBigrams()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("the quick brown fox");
+        msg->from()->addAddress("toto@titi.com", u"John Doe"_s);
+        msg->setBody("body1");
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item);
+        emailIndexer.commit();
+
+        QCOMPARE(searchEmails(u"subject"_s, u"\"quick brown\""_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"subject"_s, u"\"brown quick\""_s), QSet<qint64>());
+        QCOMPARE(searchEmails(u"from"_s, u"toto@titi.com"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"from"_s, u"titi.com@toto"_s), QSet<qint64>());
+    }
+
+    void testSubstringTrigrams()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("reinvoiced order");
+        msg->from()->addAddress("toto@titi.com", u"John Doe"_s);
+        msg->to()->addAddress("Jane.Roe@Example.org", u"Jane Roe"_s);
+        msg->setBody("body1");
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        IndexingPolicy policy;
+        policy.setSubstringTrigrams(true);
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.setIndexingPolicy(policy);
+        emailIndexer.index(item);
+        emailIndexer.commit();
+
+        QCOMPARE(searchEmails(u"subject"_s, u"invoice"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"subject"_s, u"nvoices"_s), QSet<qint64>());
+        QCOMPARE(searchEmails(u"from"_s, u"oto@ti"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"from"_s, u"ohn"_s), QSet<qint64>() << 1);
+        // Only found in the raw-case address term
+        QCOMPARE(searchEmails(u"to"_s, u"ane.roe@exa"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"body"_s, u"ody"_s), QSet<qint64>());
+    }
+
+    void testStructuredAddressTerms()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->from()->addAddress("John.Doe@Mail.Example.co.uk", u"John Doe"_s);
+        msg->setBody("body1");
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item);
+        emailIndexer.commit();
+
+        // Values are matched regardless of their case
+        QCOMPARE(searchEmails(u"fromaddress"_s, u"john.doe@mail.example.co.uk"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"fromaddress"_s, u"John.Doe@Mail.Example.co.uk"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"fromdomain"_s, u"Mail.Example.CO.UK"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"fromregistrabledomain"_s, u"EXAMPLE.co.uk"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"fromlocalpart"_s, u"John.Doe"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"todomain"_s, u"example.co.uk"_s), QSet<qint64>());
+        // Not taken for a message id
+        QCOMPARE(searchEmails(u"references"_s, u"example.co.uk"_s), QSet<qint64>());
+    }
+
+    void testThreadTerms()
+    {
+        auto root = std::make_shared<KMime::Message>();
+        root->subject()->from7BitString("subject1");
+        root->messageID()->from7BitString("<root@example.org>");
+        root->assemble();
+
+        auto reply = std::make_shared<KMime::Message>();
+        reply->subject()->from7BitString("Re: subject1");
+        reply->messageID()->from7BitString("<reply@example.org>");
+        reply->inReplyTo()->from7BitString("<root@example.org>");
+        reply->references()->from7BitString("<root@example.org>");
+        reply->assemble();
+
+        auto other = std::make_shared<KMime::Message>();
+        other->subject()->from7BitString("subject2");
+        other->messageID()->from7BitString("<other@example.org>");
+        other->assemble();
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        Akonadi::Item::Id id = 1;
+        for (const auto &msg : {root, reply, other}) {
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(id++);
+            item.setPayload(msg);
+            item.setParentCollection(Akonadi::Collection(1));
+            emailIndexer.index(item);
+        }
+        emailIndexer.commit();
+
+        QCOMPARE(searchEmails(u"thread"_s, u"<reply@example.org>"_s), QSet<qint64>({1, 2}));
+        QCOMPARE(searchEmails(u"thread"_s, u"root@example.org"_s), QSet<qint64>({1, 2}));
+        QCOMPARE(searchEmails(u"messageid"_s, u"<other@example.org>"_s), QSet<qint64>() << 3);
+        QCOMPARE(searchEmails(u"inreplyto"_s, u"root@example.org"_s), QSet<qint64>() << 2);
+    }
+
+    void testTagUpdates()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+        item.setTag(Akonadi::Tag(5));
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(item);
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"tag"_s, u"5"_s), QSet<qint64>() << 1);
+
+        emailIndexer.updateTags(item, {Akonadi::Tag(7)}, {Akonadi::Tag(5)});
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"tag"_s, u"5"_s), QSet<qint64>());
+        QCOMPARE(searchEmails(u"tag"_s, u"7"_s), QSet<qint64>() << 1);
+        QCOMPARE(searchEmails(u"subject"_s, u"subject1"_s), QSet<qint64>() << 1);
+
+        emailIndexer.removeTag(Akonadi::Tag(7));
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"tag"_s, u"7"_s), QSet<qint64>());
+    }
+
+    void testNumericValueRanges()
+    {
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        for (Akonadi::Item::Id id : {1, 2}) {
+            auto msg = std::make_shared<KMime::Message>();
+            msg->subject()->from7BitString("subject1");
+            msg->assemble();
+
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(id);
+            item.setPayload(msg);
+            item.setParentCollection(Akonadi::Collection(1));
+            // Same number of digits would hide a lexicographic comparison
+            item.setSize(id == 1 ? 9 : 10);
+            emailIndexer.index(item);
+        }
+        emailIndexer.commit();
+
+        Akonadi::Search::Query query(Akonadi::Search::Term(u"size"_s, 10, Akonadi::Search::Term::GreaterEqual));
+        query.setType(u"Email"_s);
+
+        auto emailSearchStore = new Akonadi::Search::EmailSearchStore(this);
+        emailSearchStore->setDbPath(emailDir);
+        QSet<qint64> resultSet;
+        int res = emailSearchStore->exec(query);
+        while (emailSearchStore->next(res)) {
+            resultSet << Akonadi::Search::deserialize("akonadi", emailSearchStore->id(res));
+        }
+        QCOMPARE(resultSet, QSet<qint64>() << 2);
+    }
+
+    void testDateFilter()
+    {
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        const QList<QDateTime> dates = {QDateTime(QDate(2019, 3, 1), QTime(12, 0)),
+                                        QDateTime(QDate(2019, 3, 20), QTime(12, 0)),
+                                        QDateTime(QDate(2019, 4, 1), QTime(12, 0))};
+        for (int i = 0; i < dates.size(); ++i) {
+            auto msg = std::make_shared<KMime::Message>();
+            msg->subject()->from7BitString("subject1");
+            msg->date()->setDateTime(dates.at(i));
+            msg->assemble();
+
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(i + 1);
+            item.setPayload(msg);
+            item.setParentCollection(Akonadi::Collection(1));
+            emailIndexer.index(item);
+        }
+        emailIndexer.commit();
+
+        auto emailSearchStore = new Akonadi::Search::EmailSearchStore(this);
+        emailSearchStore->setDbPath(emailDir);
+        const auto search = [emailSearchStore](int year, int month, int day) {
+            Akonadi::Search::Query query;
+            query.setType(u"Email"_s);
+            query.setDateFilter(year, month, day);
+            QSet<qint64> resultSet;
+            int res = emailSearchStore->exec(query);
+            while (emailSearchStore->next(res)) {
+                resultSet << Akonadi::Search::deserialize("akonadi", emailSearchStore->id(res));
+            }
+            return resultSet;
+        };
+        QCOMPARE(search(2019, -1, -1), QSet<qint64>({1, 2, 3}));
+        QCOMPARE(search(2019, 3, -1), QSet<qint64>({1, 2}));
+        QCOMPARE(search(2019, 3, 20), QSet<qint64>({2}));
+        QCOMPARE(search(2020, -1, -1), QSet<qint64>());
+    }
+
+    void testSortByProperty()
+    {
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        const QList<std::pair<QDate, int>> messages = {{QDate(2019, 3, 1), 200}, {QDate(2020, 1, 1), 100}, {QDate(2018, 5, 1), 100}};
+        for (int i = 0; i < messages.size(); ++i) {
+            auto msg = std::make_shared<KMime::Message>();
+            msg->subject()->from7BitString("subject1");
+            msg->date()->setDateTime(QDateTime(messages.at(i).first, QTime(12, 0)));
+            msg->assemble();
+
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(i + 1);
+            item.setPayload(msg);
+            item.setSize(messages.at(i).second);
+            item.setParentCollection(Akonadi::Collection(1));
+            emailIndexer.index(item);
+        }
+        emailIndexer.commit();
+
+        auto emailSearchStore = new Akonadi::Search::EmailSearchStore(this);
+        emailSearchStore->setDbPath(emailDir);
+        const auto search = [emailSearchStore](const QString &sortingProperty, uint limit) {
+            Akonadi::Search::Query query(Akonadi::Search::Term(u"subject"_s, u"subject1"_s));
+            query.setType(u"Email"_s);
+            query.setSortingProperty(sortingProperty);
+            query.setLimit(limit);
+            QList<qint64> results;
+            int res = emailSearchStore->exec(query);
+            while (emailSearchStore->next(res)) {
+                results << Akonadi::Search::deserialize("akonadi", emailSearchStore->id(res));
+            }
+            return results;
+        };
+        QCOMPARE(search(u"date"_s, 10), QList<qint64>({3, 1, 2}));
+        QCOMPARE(search(u"-date"_s, 10), QList<qint64>({2, 1, 3}));
+        QCOMPARE(search(u"-date"_s, 1), QList<qint64>({2}));
+        QCOMPARE(search(u"size, -date"_s, 10), QList<qint64>({2, 3, 1}));
+    }
+
+    void testContactStatistics()
+    {
+        {
+            EmailIndexer emailIndexer(emailDir, emailContactsDir);
+            const QList<QDate> dates = {QDate(2019, 3, 1), QDate(2020, 1, 1), QDate(2018, 5, 1)};
+            for (int i = 0; i < dates.size(); ++i) {
+                auto msg = std::make_shared<KMime::Message>();
+                msg->subject()->from7BitString("subject1");
+                msg->from()->from7BitString("John Doe <John.Doe@example.com>");
+                msg->date()->setDateTime(QDateTime(dates.at(i), QTime(12, 0), QTimeZone::UTC));
+                msg->assemble();
+
+                Akonadi::Item item(KMime::Message::mimeType());
+                item.setId(i + 1);
+                item.setPayload(msg);
+                item.setParentCollection(Akonadi::Collection(1));
+                emailIndexer.index(item);
+            }
+            emailIndexer.commit();
+        }
+
+        const Xapian::Database db(emailContactsDir.toStdString());
+        QCOMPARE(db.get_doccount(), Xapian::doccount(1));
+        const Xapian::Document doc = db.get_document(*db.postlist_begin(std::string()));
+        QCOMPARE(QString::fromStdString(doc.get_value(0)), u"john.doe@example.com"_s);
+        QCOMPARE(Xapian::sortable_unserialise(doc.get_value(1)), 3.0);
+        QCOMPARE(Xapian::sortable_unserialise(doc.get_value(2)), double(QDateTime(QDate(2020, 1, 1), QTime(12, 0), QTimeZone::UTC).toSecsSinceEpoch()));
+    }
+
+    void testContactReferences()
+    {
+        const auto message = [](Akonadi::Item::Id id, const char *from) {
+            auto msg = std::make_shared<KMime::Message>();
+            msg->subject()->from7BitString("subject1");
+            msg->from()->from7BitString(from);
+            msg->assemble();
+
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(id);
+            item.setPayload(msg);
+            item.setParentCollection(Akonadi::Collection(1));
+            return item;
+        };
+        const auto contactCount = [this]() {
+            return Xapian::Database(emailContactsDir.toStdString()).get_doccount();
+        };
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(message(1, "John Doe <john@example.com>"));
+        emailIndexer.index(message(2, "John Doe <john@example.com>"));
+        emailIndexer.index(message(3, "Jane Doe <jane@example.com>"));
+        emailIndexer.commit();
+        QCOMPARE(contactCount(), Xapian::doccount(2));
+
+        // Reindexing an item does not count it again
+        emailIndexer.index(message(1, "John Doe <john@example.com>"));
+        emailIndexer.commit();
+        {
+            const Xapian::Database db(emailContactsDir.toStdString());
+            const Xapian::Document doc = db.get_document(*db.postlist_begin("john@example.com"));
+            QCOMPARE(Xapian::sortable_unserialise(doc.get_value(1)), 2.0);
+        }
+
+        emailIndexer.index(message(3, "Jane Doe <jane@example.com>"));
+        emailIndexer.remove(Akonadi::Item(3));
+        emailIndexer.commit();
+        QCOMPARE(contactCount(), Xapian::doccount(1));
+
+        emailIndexer.remove(Akonadi::Item(1));
+        emailIndexer.commit();
+        QCOMPARE(contactCount(), Xapian::doccount(1));
+
+        emailIndexer.remove(Akonadi::Item(2));
+        emailIndexer.commit();
+        QCOMPARE(contactCount(), Xapian::doccount(0));
+    }
+
+    void testUnreferencedContactsAfterRestart()
+    {
+        {
+            // Left behind by a session which did not get to drop it
+            Xapian::WritableDatabase db(emailContactsDir.toStdString(), Xapian::DB_CREATE_OR_OPEN);
+            Xapian::Document doc;
+            doc.set_data("John Doe <john@example.com>");
+            doc.add_term("john@example.com");
+            doc.add_value(1, Xapian::sortable_serialise(0));
+            db.add_document(doc);
+            db.commit();
+        }
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.commit();
+        QCOMPARE(Xapian::Database(emailContactsDir.toStdString()).get_doccount(), Xapian::doccount(0));
+    }
+
+    void testContactExpiry()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->from()->from7BitString("John Doe <john@example.com>");
+        msg->date()->setDateTime(QDateTime(QDate(2018, 5, 1), QTime(12, 0), QTimeZone::UTC));
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        IndexingPolicy policy;
+        policy.setContactExpiryDays(30);
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.setIndexingPolicy(policy);
+        emailIndexer.index(item);
+        emailIndexer.commit();
+
+        // Not seen for years, but still referenced by a message
+        QCOMPARE(Xapian::Database(emailContactsDir.toStdString()).get_doccount(), Xapian::doccount(1));
+    }
+
+    void testContactRecord()
+    {
+        KContacts::Addressee addressee;
+        addressee.setFormattedName(u"John Doe"_s);
+        addressee.setEmails({u"john.doe@kmail.com"_s, u"jd@example.com"_s});
+
+        Akonadi::Item item(KContacts::Addressee::mimeType());
+        item.setId(6);
+        item.setPayload(addressee);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        {
+            ContactIndexer contactIndexer(contactsDir);
+            contactIndexer.index(item);
+            contactIndexer.commit();
+        }
+
+        const Xapian::Database db(contactsDir.toStdString());
+        const std::string data = db.get_document(6).get_data();
+        const auto record = Akonadi::Search::PIM::ContactRecord::fromData(QByteArray(data.data(), data.size()));
+        QCOMPARE(record.name(), u"John Doe"_s);
+        QCOMPARE(record.emails(), QStringList({u"john.doe@kmail.com"_s, u"jd@example.com"_s}));
+        QVERIFY(record.thumbnail().isEmpty());
+    }
+
+    void testContactQueryRefinement()
+    {
+        ContactIndexer contactIndexer(contactsDir);
+        contactIndexer.index(contactItem(1, u"Jane Doe"_s));
+        contactIndexer.index(contactItem(2, u"Janis Roe"_s));
+        contactIndexer.index(contactItem(3, u"Jack Black"_s));
+        contactIndexer.index(contactItem(4, u"Bob Smith"_s));
+        contactIndexer.commit();
+
+        // Refined when owner is set, searched again otherwise
+        const auto search = [](const QString &name, int limit, const void *owner) {
+            Akonadi::Search::PIM::ContactQuery query;
+            query.matchName(name);
+            query.setLimit(limit);
+            return resultIds(owner ? query.execAsync(owner).result() : query.exec());
+        };
+
+        int owner = 0;
+        QCOMPARE(search(u"ja"_s, 10, &owner), QSet<qint64>({1, 2, 3}));
+        QCOMPARE(search(u"jan"_s, 10, &owner), search(u"jan"_s, 10, nullptr));
+        QCOMPARE(search(u"jan"_s, 10, nullptr), QSet<qint64>({1, 2}));
+        QCOMPARE(search(u"jane"_s, 10, &owner), QSet<qint64>({1}));
+
+        // A commit after the previous query makes it a full one
+        QCOMPARE(search(u"ja"_s, 10, &owner), QSet<qint64>({1, 2, 3}));
+        contactIndexer.index(contactItem(5, u"Janice Poe"_s));
+        contactIndexer.commit();
+        QCOMPARE(search(u"jan"_s, 10, &owner), QSet<qint64>({1, 2, 5}));
+
+        // Results cut by the limit are not refined
+        int otherOwner = 0;
+        QCOMPARE(search(u"ja"_s, 1, &otherOwner).size(), 1);
+        QCOMPARE(search(u"jan"_s, 10, &otherOwner), QSet<qint64>({1, 2, 5}));
+    }
+
+    void testCompletionUpdates()
+    {
+        EmailIndexer emailIndexer(emailDir, completionContactsDir);
+        emailIndexer.index(messageFrom(1, "Nora Quill <nora@example.org>"));
+        emailIndexer.commit();
+        QCOMPARE(completions(u"nor"_s), QStringList({u"Nora Quill <nora@example.org>"_s}));
+
+        // Caught up from the change list of the commit
+        emailIndexer.index(messageFrom(2, "Norbert Quince <norbert@example.org>"));
+        emailIndexer.commit();
+        QCOMPARE(completions(u"nor"_s), QStringList({u"Nora Quill <nora@example.org>"_s, u"Norbert Quince <norbert@example.org>"_s}));
+
+        // The last message of a contact is removed
+        emailIndexer.remove(Akonadi::Item(1));
+        emailIndexer.commit();
+        QCOMPARE(completions(u"nor"_s), QStringList({u"Norbert Quince <norbert@example.org>"_s}));
+
+        // More commits than the change lists kept, everything is read again
+        const Xapian::rev completedRevision = Xapian::Database(completionContactsDir.toStdString()).get_revision();
+        for (Akonadi::Item::Id id = 10; id < 10 + static_cast<Akonadi::Item::Id>(Akonadi::Search::MaxContactChangeRevisions); ++id) {
+            const QByteArray from = "Contact " + QByteArray::number(id) + " <contact" + QByteArray::number(id) + "@example.org>";
+            emailIndexer.index(messageFrom(id, from.constData()));
+            emailIndexer.commit();
+        }
+        emailIndexer.index(messageFrom(100, "Nolan Quest <nolan@example.org>"));
+        emailIndexer.remove(Akonadi::Item(2));
+        emailIndexer.commit();
+
+        const Xapian::Database db(completionContactsDir.toStdString());
+        QVERIFY(db.get_revision() - completedRevision > Akonadi::Search::MaxContactChangeRevisions);
+        QVERIFY(db.get_metadata(Akonadi::Search::contactChangesKey(completedRevision + 1)).empty());
+        QCOMPARE(completions(u"no"_s), QStringList({u"Nolan Quest <nolan@example.org>"_s}));
+    }
+
+    void testAsyncCancellation()
+    {
+        ContactIndexer contactIndexer(contactsDir);
+        contactIndexer.index(contactItem(1, u"Olga Pike"_s));
+        contactIndexer.index(contactItem(2, u"Oliver Reed"_s));
+        contactIndexer.commit();
+
+        EmailIndexer emailIndexer(emailDir, completionContactsDir);
+        emailIndexer.index(messageFrom(1, "Olga Pike <olga@example.org>"));
+        emailIndexer.commit();
+
+        Akonadi::Search::PIM::ContactQuery contactQuery;
+        contactQuery.matchName(u"ol"_s);
+
+        // Queue the queries behind a blocked thread, so none starts before the next one
+        QThreadPool *pool = QThreadPool::globalInstance();
+        const int maxThreadCount = pool->maxThreadCount();
+        pool->setMaxThreadCount(1);
+        QSemaphore started;
+        QSemaphore blocked;
+        pool->start([&started, &blocked]() {
+            started.release();
+            blocked.acquire();
+        });
+        started.acquire();
+
+        int owner = 0;
+        int otherOwner = 0;
+        QFuture<Akonadi::Search::PIM::ResultIterator> queryFuture = contactQuery.execAsync(&owner);
+        QFuture<QStringList> firstCompletion = Akonadi::Search::PIM::ContactCompleter(u"ol"_s).completeAsync(&owner);
+        QFuture<QStringList> secondCompletion = Akonadi::Search::PIM::ContactCompleter(u"olg"_s).completeAsync(&owner);
+        QFuture<Akonadi::Search::PIM::ResultIterator> otherQueryFuture = contactQuery.execAsync(&otherOwner);
+        blocked.release();
+
+        queryFuture.waitForFinished();
+        firstCompletion.waitForFinished();
+        secondCompletion.waitForFinished();
+        otherQueryFuture.waitForFinished();
+        pool->setMaxThreadCount(maxThreadCount);
+
+        // A contact query and a completion of the same owner cancel each other
+        QVERIFY(queryFuture.isCanceled());
+        QVERIFY(firstCompletion.isCanceled());
+        QVERIFY(!secondCompletion.isCanceled());
+        QCOMPARE(secondCompletion.result(), Akonadi::Search::PIM::ContactCompleter(u"olg"_s).complete());
+        QCOMPARE(secondCompletion.result(), QStringList({u"Olga Pike <olga@example.org>"_s}));
+
+        QVERIFY(!otherQueryFuture.isCanceled());
+        QCOMPARE(resultIds(otherQueryFuture.result()), resultIds(contactQuery.exec()));
+        QCOMPARE(resultIds(contactQuery.exec()), QSet<qint64>({1, 2}));
+    }
+
+    void testAncestorTerms()
+    {
+        // An account with an inbox and an archive, which has a subfolder
+        Akonadi::Collection account(10);
+        account.setResource(u"akonadi_imap_resource_0"_s);
+        Akonadi::Collection inbox(11);
+        inbox.setParentCollection(account);
+        Akonadi::Collection archive(12);
+        archive.setParentCollection(account);
+        Akonadi::Collection archive2025(13);
+        archive2025.setParentCollection(archive);
+
+        const auto message = [](Akonadi::Item::Id id, const Akonadi::Collection &collection) {
+            auto msg = std::make_shared<KMime::Message>();
+            msg->subject()->from7BitString("subject1");
+            msg->assemble();
+
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(id);
+            item.setPayload(msg);
+            item.setParentCollection(collection);
+            return item;
+        };
+
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        emailIndexer.index(message(1, inbox));
+        emailIndexer.index(message(2, archive));
+        emailIndexer.index(message(3, archive2025));
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"subtree"_s, u"10"_s), QSet<qint64>({1, 2, 3}));
+        QCOMPARE(searchEmails(u"subtree"_s, u"12"_s), QSet<qint64>({2, 3}));
+        QCOMPARE(searchEmails(u"subtree"_s, u"13"_s), QSet<qint64>({3}));
+        QCOMPARE(searchEmails(u"resource"_s, u"akonadi_imap_resource_0"_s), QSet<qint64>({1, 2, 3}));
+
+        // Moving an item replaces all its ancestors
+        emailIndexer.move(3, archive2025, inbox);
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"subtree"_s, u"12"_s), QSet<qint64>({2}));
+        QCOMPARE(searchEmails(u"subtree"_s, u"11"_s), QSet<qint64>({1, 3}));
+        QCOMPARE(searchEmails(u"subtree"_s, u"10"_s), QSet<qint64>({1, 2, 3}));
+
+        // Moving the archive into a local folder updates the items of its subtree
+        emailIndexer.move(2, archive, archive2025);
+        emailIndexer.commit();
+        Akonadi::Collection local(20);
+        local.setResource(u"akonadi_maildir_resource_0"_s);
+        emailIndexer.move(archive, account, local);
+        emailIndexer.commit();
+        QCOMPARE(searchEmails(u"subtree"_s, u"20"_s), QSet<qint64>({2}));
+        QCOMPARE(searchEmails(u"subtree"_s, u"12"_s), QSet<qint64>({2}));
+        QCOMPARE(searchEmails(u"subtree"_s, u"10"_s), QSet<qint64>({1, 3}));
+        QCOMPARE(searchEmails(u"resource"_s, u"akonadi_imap_resource_0"_s), QSet<qint64>({1, 3}));
+        QCOMPARE(searchEmails(u"resource"_s, u"akonadi_maildir_resource_0"_s), QSet<qint64>({2}));
+    }
+
+    void testConcurrentQueries()
+    {
+        {
+            EmailIndexer emailIndexer(emailDir, emailContactsDir);
+            for (Akonadi::Item::Id id = 1; id <= 20; ++id) {
+                auto msg = std::make_shared<KMime::Message>();
+                msg->subject()->from7BitString(id % 2 ? "odd" : "even");
+                msg->setBody("body");
+                msg->assemble();
+
+                Akonadi::Item item(KMime::Message::mimeType());
+                item.setId(id);
+                item.setPayload(msg);
+                item.setParentCollection(Akonadi::Collection(1));
+                emailIndexer.index(item);
+            }
+            emailIndexer.commit();
+        }
+
+        Akonadi::Search::EmailSearchStore emailSearchStore;
+        emailSearchStore.setDbPath(emailDir);
+        const auto search = [&emailSearchStore](const QString &subject) {
+            QSet<qint64> resultSet;
+            Akonadi::Search::Query query(Akonadi::Search::Term(u"subject"_s, subject, Akonadi::Search::Term::Contains));
+            query.setType(u"Email"_s);
+            const int res = emailSearchStore.exec(query);
+            while (emailSearchStore.next(res)) {
+                resultSet << emailSearchStore.numericId(res);
+            }
+            emailSearchStore.close(res);
+            return resultSet;
+        };
+        const QSet<qint64> odd = search(u"odd"_s);
+        const QSet<qint64> even = search(u"even"_s);
+        QCOMPARE(odd.size(), 10);
+        QCOMPARE(even.size(), 10);
+
+        // Queries of several threads share the store, but not their results
+        std::atomic<int> mismatches = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&, i]() {
+                for (int j = 0; j < 50; ++j) {
+                    const bool isOdd = (i + j) % 2;
+                    if (search(isOdd ? u"odd"_s : u"even"_s) != (isOdd ? odd : even)) {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        QCOMPARE(mismatches.load(), 0);
+    }
+
+    void testQuarantineOverBudget()
+    {
+        auto msg = std::make_shared<KMime::Message>();
+        msg->subject()->from7BitString("subject1");
+        msg->setBody("a body which is larger than the budget");
+        msg->assemble();
+
+        Akonadi::Item item(KMime::Message::mimeType());
+        item.setId(1);
+        item.setPayload(msg);
+        item.setParentCollection(Akonadi::Collection(1));
+
+        IndexingPolicy policy;
+        policy.setMaxDecodedBytesPerItem(8);
+
+        {
+            EmailIndexer emailIndexer(emailDir, emailContactsDir);
+            emailIndexer.setIndexingPolicy(policy);
+            emailIndexer.index(item);
+            emailIndexer.commit();
+            QCOMPARE(getAllEmailItems(), QSet<qint64>() << 1);
+            QVERIFY(emailIndexer.quarantinedItems().contains(1));
+        }
+
+        // The quarantine survives a restart of the agent
+        EmailIndexer emailIndexer(emailDir, emailContactsDir);
+        QCOMPARE(emailIndexer.quarantinedItems().value(1), u"Decoded size exceeds 8 bytes"_s);
+
+        emailIndexer.remove(item);
+        QVERIFY(emailIndexer.quarantinedItems().isEmpty());
+    }
+
     void testCalendarRemoveByCollection()
     {
         CalendarIndexer calendarIndexer(calendarsDir);
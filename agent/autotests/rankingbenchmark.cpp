@@ -0,0 +1,100 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include <QDateTime>
+#include <QTest>
+
+#include "../search/email/agepostingsource.h"
+
+#include <xapian.h>
+
+#include <memory>
+
+using namespace Akonadi::Search;
+
+// Every benchmark iteration ranks this many candidates
+static constexpr int candidateCount = 100000;
+
+class RankingBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    std::unique_ptr<Xapian::WritableDatabase> m_db;
+    double m_now = 0;
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        m_db = std::make_unique<Xapian::WritableDatabase>(std::string(), Xapian::DB_BACKEND_INMEMORY);
+        m_now = static_cast<double>(QDateTime::currentSecsSinceEpoch());
+        for (int i = 0; i < candidateCount; ++i) {
+            Xapian::Document doc;
+            doc.add_boolean_term("E");
+            // One message every ten minutes, going back about two years
+            doc.add_value(0, Xapian::sortable_serialise(m_now - i * 600.0));
+            m_db->add_document(doc);
+        }
+        m_db->commit();
+    }
+
+    void testWeight()
+    {
+        AgePostingSource source(0, m_now);
+        source.init(*m_db);
+        source.next(0.0);
+        QCOMPARE(source.get_weight(), 1000.0);
+
+        // 144 messages per day
+        source.skip_to(144 * 10 + 1, 0.0);
+        QCOMPARE(source.get_docid(), Xapian::docid(144 * 10 + 1));
+        QCOMPARE(source.get_weight(), 990.0);
+    }
+
+    void benchmarkGetWeight()
+    {
+        double total = 0;
+        QBENCHMARK {
+            AgePostingSource source(0, m_now);
+            source.init(*m_db);
+            for (source.next(0.0); !source.at_end(); source.next(0.0)) {
+                total += source.get_weight();
+            }
+        }
+        QVERIFY(total > 0);
+    }
+
+    void benchmarkQuery_data()
+    {
+        QTest::addColumn<bool>("ranked");
+
+        QTest::newRow("unranked") << false;
+        QTest::newRow("recency") << true;
+    }
+
+    void benchmarkQuery()
+    {
+        QFETCH(bool, ranked);
+
+        QBENCHMARK {
+            Xapian::Query query("E");
+            Xapian::Enquire enquire(*m_db);
+            if (ranked) {
+                query = Xapian::Query(Xapian::Query::OP_AND_MAYBE, query, Xapian::Query((new AgePostingSource(0, m_now))->release()));
+            } else {
+                enquire.set_weighting_scheme(Xapian::BoolWeight());
+            }
+            enquire.set_query(query);
+            const Xapian::MSet mset = enquire.get_mset(0, 100, candidateCount);
+            QCOMPARE(mset.get_matches_estimated(), Xapian::doccount(candidateCount));
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(RankingBenchmark)
+
+#include "rankingbenchmark.moc"
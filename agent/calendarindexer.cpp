@@ -105,7 +105,7 @@ void CalendarIndexer::remove(const Akonadi::Collection &collection)
     }
 }
 
-void CalendarIndexer::move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from, Akonadi::Collection::Id to)
+void CalendarIndexer::move(Akonadi::Item::Id itemId, const Akonadi::Collection &from, const Akonadi::Collection &to)
 {
     if (!m_db) {
         return;
@@ -117,14 +117,31 @@ void CalendarIndexer::move(Akonadi::Item::Id itemId, Akonadi::Collection::Id fro
         return;
     }
 
-    const QByteArray ft = 'C' + QByteArray::number(from);
-    const QByteArray tt = 'C' + QByteArray::number(to);
+    const QByteArray ft = 'C' + QByteArray::number(from.id());
+    const QByteArray tt = 'C' + QByteArray::number(to.id());
 
     doc.remove_term(ft.data());
     doc.add_boolean_term(tt.data());
+    setAncestorTerms(doc, to);
     m_db->replaceDocument(doc.get_docid(), doc);
 }
 
+void CalendarIndexer::move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to)
+{
+    if (!m_db) {
+        return;
+    }
+
+    Xapian::Database *db = m_db->db();
+    const std::string term = "XCA:" + std::to_string(collection.id());
+    const std::vector<Xapian::docid> ids(db->postlist_begin(term), db->postlist_end(term));
+    for (const Xapian::docid id : ids) {
+        Xapian::Document doc = db->get_document(id);
+        moveAncestorTerms(doc, from, to);
+        m_db->replaceDocument(id, doc);
+    }
+}
+
 void CalendarIndexer::indexEventItem(const Akonadi::Item &item, const KCalendarCore::Event::Ptr &event)
 {
     qCDebug(AKONADI_INDEXER_AGENT_CALENDAR_LOG) << "Indexing calendar event:" << normalizeString(event->summary()) << event->organizer().email();
@@ -144,6 +161,12 @@ void CalendarIndexer::indexEventItem(const Akonadi::Item &item, const KCalendarC
 
     const Akonadi::Collection::Id colId = item.parentCollection().id();
     doc.addBoolTerm(colId, u"C"_s);
+    const QByteArrayList ancestors = ancestorTerms(item.parentCollection());
+    for (const QByteArray &term : ancestors) {
+        doc.addBoolTerm(QByteArrayView(term));
+    }
+
+    doc.addDateTerms(event->dtStart().date());
 
     m_db->replaceDocument(item.id(), doc);
 }
@@ -21,6 +21,7 @@
 class CalendarIndexer : public AbstractIndexer
 {
 public:
+    using AbstractIndexer::index; // So we don't trigger -Woverloaded-virtual
     /**
      * You must provide the path where the indexed information
      * should be stored
@@ -35,7 +36,8 @@ public:
 
     void remove(const Akonadi::Item &item) override;
     void remove(const Akonadi::Collection &collection) override;
-    void move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from, Akonadi::Collection::Id to) override;
+    void move(Akonadi::Item::Id itemId, const Akonadi::Collection &from, const Akonadi::Collection &to) override;
+    void move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to) override;
 
 private:
     void indexEventItem(const Akonadi::Item &item, const KCalendarCore::Event::Ptr &event);
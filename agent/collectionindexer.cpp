@@ -8,6 +8,7 @@
 #include <xapian.h>
 
 #include "collectionindexer.h"
+#include "abstractindexer.h"
 #include "xapiandocument.h"
 
 #include <Akonadi/AttributeFactory>
@@ -78,6 +79,9 @@ void CollectionIndexer::index(const Akonadi::Collection &collection)
         const QByteArray term = 'C' + QByteArray::number(colId);
         doc.add_boolean_term(term.constData());
 
+        // The same subtree terms as the items, to find out which collections a subtree holds
+        AbstractIndexer::setAncestorTerms(doc, collection);
+
         QByteArray ns;
         if (const auto folderAttribute = collection.attribute<Akonadi::CollectionIdentificationAttribute>()) {
             if (!folderAttribute->collectionNamespace().isEmpty()) {
@@ -6,6 +6,7 @@
  */
 #include "collectionindexingjob.h"
 #include "abstractindexer.h"
+#include "indexingtierattribute.h"
 #include <Akonadi/AgentBase>
 #include <Akonadi/CollectionFetchJob>
 #include <Akonadi/CollectionFetchScope>
@@ -13,6 +14,8 @@
 #include <Akonadi/IndexPolicyAttribute>
 #include <Akonadi/ItemFetchJob>
 #include <Akonadi/ItemFetchScope>
+#include <Akonadi/TagFetchScope>
+#include <Akonadi/MessageParts>
 #include <Akonadi/ServerManager>
 #include <KLocalizedString>
 #include <akonadi_indexer_agent_debug.h>
@@ -38,8 +41,11 @@ void CollectionIndexingJob::start()
     // Fetch collection for statistics
     auto job = new Akonadi::CollectionFetchJob(m_collection, Akonadi::CollectionFetchJob::Base);
     job->fetchScope().setIncludeStatistics(true);
+    // The items are indexed with the ancestors of their collection
+    job->fetchScope().setAncestorRetrieval(Akonadi::CollectionFetchScope::All);
     job->fetchScope().setListFilter(Akonadi::CollectionFetchScope::NoFilter);
     job->fetchScope().fetchAttribute<Akonadi::IndexPolicyAttribute>();
+    job->fetchScope().fetchAttribute<IndexingTierAttribute>();
     connect(job, &KJob::finished, this, &CollectionIndexingJob::slotOnCollectionFetched);
     job->start();
 }
@@ -59,6 +65,9 @@ void CollectionIndexingJob::slotOnCollectionFetched(KJob *job)
         return;
     }
 
+    m_tier = m_index.indexingPolicy().tierForCollection(m_collection);
+    qCDebug(AKONADI_INDEXER_AGENT_LOG) << "Indexing tier for collection" << m_collection.id() << IndexingPolicy::tierToString(m_tier);
+
     Q_EMIT status(Akonadi::AgentBase::Running, i18n("Indexing collection: %1", m_collection.displayName()));
     Q_EMIT percent(0);
 
@@ -90,12 +99,19 @@ void CollectionIndexingJob::indexItems(const QList<Akonadi::Item::Id> &itemIds)
     }
 
     auto fetchJob = new Akonadi::ItemFetchJob(items);
-    fetchJob->fetchScope().fetchFullPayload(true);
+    if (m_tier == IndexingTier::Full) {
+        fetchJob->fetchScope().fetchFullPayload(true);
+    } else {
+        // Lower tiers never look at the body, don't fetch it
+        fetchJob->fetchScope().fetchPayloadPart(Akonadi::MessagePart::Header);
+    }
     fetchJob->fetchScope().setCacheOnly(true);
     fetchJob->fetchScope().setIgnoreRetrievalErrors(true);
     fetchJob->fetchScope().setFetchRemoteIdentification(false);
     fetchJob->fetchScope().setFetchModificationTime(true);
     fetchJob->fetchScope().setAncestorRetrieval(Akonadi::ItemFetchScope::Parent);
+    fetchJob->fetchScope().setFetchTags(true);
+    fetchJob->fetchScope().tagFetchScope().setFetchIdOnly(true);
     fetchJob->setDeliveryOption(Akonadi::ItemFetchJob::EmitItemsIndividually);
     fetchJob->setProperty("count", items.size());
     fetchJob->setProperty("start", m_time.elapsed());
@@ -112,7 +128,14 @@ void CollectionIndexingJob::slotPendingItemsReceived(const Akonadi::Item::List &
     qCDebug(AKONADI_INDEXER_AGENT_LOG) << "CollectionIndexingJob::slotPendingItemsReceived" << items.count();
     for (const Akonadi::Item &item : items) {
         qCDebug(AKONADI_INDEXER_AGENT_LOG) << "void CollectionIndexingJob::slotPendingItemsReceived(const Akonadi::Item::List &items)" << item.id();
-        m_index.index(item);
+        if (item.parentCollection().id() == m_collection.id()) {
+            // The fetched parent only has an id, ours knows its ancestors and resource
+            Akonadi::Item indexedItem = item;
+            indexedItem.setParentCollection(m_collection);
+            m_index.index(indexedItem, m_tier);
+        } else {
+            m_index.index(item, m_tier);
+        }
     }
     m_progressCounter++;
     Q_EMIT percent(100.0 * m_progressCounter / m_progressTotal);
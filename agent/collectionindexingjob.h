@@ -46,6 +46,7 @@ private:
     QList<Akonadi::Item::Id> m_needsIndexing;
     Index &m_index;
     QElapsedTimer m_time;
+    IndexingTier m_tier = IndexingTier::Full;
     bool m_reindexingLock = false;
     bool m_fullSync = true;
     int m_progressCounter = 0;
@@ -10,12 +10,40 @@
 using namespace Qt::Literals::StringLiterals;
 
 #include "akonadi_indexer_agent_debug.h"
+#include "contactrecord.h"
 #include "xapiandocument.h"
 
 #include <Akonadi/Collection>
 #include <KContacts/Addressee>
 #include <KContacts/ContactGroup>
 
+#include <QBuffer>
+#include <QImage>
+
+namespace
+{
+// Size of the photo thumbnails stored for the search results
+constexpr int ThumbnailSize = 16;
+
+QByteArray thumbnailData(const KContacts::Picture &photo)
+{
+    if (photo.isEmpty()) {
+        return {};
+    }
+    const QImage img = photo.data();
+    if (img.isNull()) {
+        return {};
+    }
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    if (!img.scaled(ThumbnailSize, ThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation).save(&buffer, "PNG")) {
+        return {};
+    }
+    return png;
+}
+}
+
 ContactIndexer::ContactIndexer(const QString &path)
 
 {
@@ -85,13 +113,23 @@ bool ContactIndexer::indexContact(const Akonadi::Item &item)
 
     const Akonadi::Collection::Id colId = item.parentCollection().id();
     doc.addBoolTerm(colId, u"C"_s);
+    const QByteArrayList ancestors = ancestorTerms(item.parentCollection());
+    for (const QByteArray &term : ancestors) {
+        doc.addBoolTerm(QByteArrayView(term));
+    }
 
     if (addressee.birthday().isValid()) {
-        const QString julianDay = QString::number(addressee.birthday().date().toJulianDay());
-        doc.addValue(0, julianDay);
+        doc.addNumericValue(0, addressee.birthday().date().toJulianDay());
     }
     // TODO index anniversary ?
 
+    // What the search results display, so they don't need to fetch the item
+    Akonadi::Search::PIM::ContactRecord record;
+    record.setName(name);
+    record.setEmails(lstEmails);
+    record.setThumbnail(thumbnailData(addressee.photo()));
+    doc.setData(record.toData());
+
     m_db->replaceDocument(item.id(), doc);
     return true;
 }
@@ -119,6 +157,10 @@ void ContactIndexer::indexContactGroup(const Akonadi::Item &item)
 
     const Akonadi::Collection::Id colId = item.parentCollection().id();
     doc.addBoolTerm(colId, u"C"_s);
+    const QByteArrayList ancestors = ancestorTerms(item.parentCollection());
+    for (const QByteArray &term : ancestors) {
+        doc.addBoolTerm(QByteArrayView(term));
+    }
     m_db->replaceDocument(item.id(), doc);
 }
 
@@ -172,7 +214,7 @@ void ContactIndexer::commit()
     qCDebug(AKONADI_INDEXER_AGENT_LOG) << "Xapian Committed";
 }
 
-void ContactIndexer::move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from, Akonadi::Collection::Id to)
+void ContactIndexer::move(Akonadi::Item::Id itemId, const Akonadi::Collection &from, const Akonadi::Collection &to)
 {
     if (!m_db) {
         return;
@@ -185,10 +227,32 @@ void ContactIndexer::move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from
         return;
     }
 
-    const QByteArray ft = 'C' + QByteArray::number(from);
-    const QByteArray tt = 'C' + QByteArray::number(to);
+    const QByteArray ft = 'C' + QByteArray::number(from.id());
+    const QByteArray tt = 'C' + QByteArray::number(to.id());
 
     std::ignore = doc.removeTermStartsWith(ft.data());
-    doc.addBoolTerm(QString::fromLatin1(tt.data()));
+    doc.addBoolTerm(QByteArrayView(tt));
+    std::ignore = doc.removeTermStartsWith("XCA:");
+    std::ignore = doc.removeTermStartsWith("XCR:");
+    const QByteArrayList ancestors = ancestorTerms(to);
+    for (const QByteArray &term : ancestors) {
+        doc.addBoolTerm(QByteArrayView(term));
+    }
     m_db->replaceDocument(doc.doc().get_docid(), doc);
 }
+
+void ContactIndexer::move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to)
+{
+    if (!m_db) {
+        return;
+    }
+
+    Xapian::Database *db = m_db->db();
+    const std::string term = "XCA:" + std::to_string(collection.id());
+    const std::vector<Xapian::docid> ids(db->postlist_begin(term), db->postlist_end(term));
+    for (const Xapian::docid id : ids) {
+        Xapian::Document doc = db->get_document(id);
+        moveAncestorTerms(doc, from, to);
+        m_db->replaceDocument(id, doc);
+    }
+}
@@ -13,6 +13,7 @@
 class ContactIndexer : public AbstractIndexer
 {
 public:
+    using AbstractIndexer::index; // So we don't trigger -Woverloaded-virtual
     explicit ContactIndexer(const QString &path);
     ~ContactIndexer() override;
 
@@ -24,7 +25,8 @@ public:
 
     void commit() override;
 
-    void move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from, Akonadi::Collection::Id to) override;
+    void move(Akonadi::Item::Id itemId, const Akonadi::Collection &from, const Akonadi::Collection &to) override;
+    void move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to) override;
 
 private:
     [[nodiscard]] bool indexContact(const Akonadi::Item &item);
@@ -10,15 +10,93 @@
 using namespace Qt::Literals::StringLiterals;
 
 #include "akonadi_indexer_agent_email_debug.h"
+#include "search/email/addressterms.h"
+#include "search/email/contactchanges.h"
+#include "xapiandocument.h"
+#include "xapiantermgenerator.h"
 
 #include <Akonadi/Collection>
 #include <Akonadi/MessageFlags>
 #include <KEmailAddress>
 
 #include <QProcess>
+#include <QtEndian>
 
-EmailIndexer::EmailIndexer(const QString &path, const QString &contactDbPath)
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr int MaxQuarantinedItems = 1000;
+// Metadata of the email database keeping the quarantine across restarts,
+// one "<item id>\t<reason>" line per item, oldest first
+constexpr char QuarantineMetadataKey[] = "quarantinedItems";
+// Bodies are fed to Xapian in chunks of this size, the time budget is checked between them
+constexpr qsizetype BodyChunkSize = 256 * 1024;
+
+// Value slots of the emailContacts documents
+constexpr Xapian::valueno ContactAddressSlot = 0;
+// The number of indexed messages referring to the contact. It ranks the
+// completions and is its reference count: the contact is dropped at zero.
+constexpr Xapian::valueno ContactFrequencySlot = 1;
+constexpr Xapian::valueno ContactLastSeenSlot = 2;
+// Value slot of the emails listing their contacts, as big endian docids
+constexpr Xapian::valueno ContactIdsSlot = 3;
+
+double contactValue(const Xapian::Document &doc, Xapian::valueno slot)
+{
+    const std::string value = doc.get_value(slot);
+    return value.empty() ? 0 : Xapian::sortable_unserialise(value);
+}
+
+std::string tagTerm(const Akonadi::Tag &tag)
+{
+    return "XTG:" + std::to_string(tag.id());
+}
 
+// Attachments worth extracting text from
+bool isTextAttachment(const QByteArray &mimeType)
+{
+    static const QByteArrayList textTypes = {
+        QByteArrayLiteral("text/plain"),
+        QByteArrayLiteral("text/csv"),
+        QByteArrayLiteral("text/tab-separated-values"),
+        QByteArrayLiteral("text/calendar"),
+        QByteArrayLiteral("text/vcard"),
+        QByteArrayLiteral("text/x-vcard"),
+        QByteArrayLiteral("text/directory"),
+    };
+    return textTypes.contains(mimeType);
+}
+
+// Name of the transfer encoding of a part, for KCodecs
+QByteArray transferEncoding(KMime::Content *content)
+{
+    const KMime::Headers::ContentTransferEncoding *cte = content->contentTransferEncoding(KMime::DontCreate);
+    switch (cte ? cte->encoding() : KMime::Headers::CE7Bit) {
+    case KMime::Headers::CEbase64:
+        return QByteArrayLiteral("base64");
+    case KMime::Headers::CEquPr:
+        return QByteArrayLiteral("quoted-printable");
+    case KMime::Headers::CEuuenc:
+        return QByteArrayLiteral("x-uuencode");
+    default:
+        break;
+    }
+    return {};
+}
+
+bool isAscii(const QByteArray &data)
+{
+    return std::all_of(data.cbegin(), data.cend(), [](char c) {
+        return static_cast<unsigned char>(c) < 0x80;
+    });
+}
+}
+
+EmailIndexer::EmailIndexer(const QString &path, const QString &contactDbPath)
+    : m_attachmentExtractor(std::make_unique<AttachmentExtractor>())
 {
     try {
         m_db = new Xapian::WritableDatabase(path.toStdString(), Xapian::DB_CREATE_OR_OPEN);
@@ -41,10 +119,14 @@ EmailIndexer::EmailIndexer(const QString &path, const QString &contactDbPath)
         qCWarning(AKONADI_INDEXER_AGENT_EMAIL_LOG) << QString::fromStdString(e.get_type()) << QString::fromStdString(e.get_description());
         m_contactDb = nullptr;
     }
+
+    updateTermMetadata();
+    loadQuarantine();
 }
 
 EmailIndexer::~EmailIndexer()
 {
+    m_attachmentExtractor->waitForDone();
     commit();
     delete m_db;
     delete m_contactDb;
@@ -57,7 +139,12 @@ QStringList EmailIndexer::mimeTypes() const
 
 void EmailIndexer::index(const Akonadi::Item &item)
 {
-    qCDebug(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Indexing item" << item.id();
+    index(item, IndexingTier::Full);
+}
+
+void EmailIndexer::index(const Akonadi::Item &item, IndexingTier tier)
+{
+    qCDebug(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Indexing item" << item.id() << "tier" << IndexingPolicy::tierToString(tier);
     if (!m_db) {
         return;
     }
@@ -79,11 +166,34 @@ void EmailIndexer::index(const Akonadi::Item &item)
     m_termGen->set_document(*m_doc);
     m_termGen->set_database(*m_db);
 
+    m_itemTimer.start();
+    m_decodedBytes = 0;
+    m_budgetExceeded.clear();
+    m_messageContacts.clear();
+
     processMessageStatus(status);
-    process(msg);
+    process(msg, tier);
+
+    if (!m_budgetExceeded.isEmpty()) {
+        qCWarning(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Item" << item.id() << "exceeded its indexing budget:" << m_budgetExceeded;
+        quarantine(item.id(), m_budgetExceeded);
+
+        // Start over with a degraded document
+        delete m_doc;
+        delete m_termGen;
+        m_doc = new Xapian::Document();
+        m_termGen = new Xapian::TermGenerator();
+        m_termGen->set_document(*m_doc);
+        m_termGen->set_database(*m_db);
+
+        processMessageStatus(status);
+        process(msg, std::max(tier, IndexingTier::HeadersOnly));
+    } else {
+        unquarantine(item.id());
+    }
 
     // Size
-    m_doc->add_value(1, QString::number(item.size()).toStdString());
+    m_doc->add_value(1, Xapian::sortable_serialise(item.size()));
 
     // Parent collection
     Q_ASSERT_X(item.parentCollection().isValid(), "Akonadi::Search::EmailIndexer::index", "Item does not have a valid parent collection");
@@ -91,8 +201,40 @@ void EmailIndexer::index(const Akonadi::Item &item)
     const Akonadi::Collection::Id colId = item.parentCollection().id();
     const QByteArray term = 'C' + QByteArray::number(colId);
     m_doc->add_boolean_term(term.data());
+    setAncestorTerms(*m_doc, item.parentCollection());
+
+    // Tags, kept up to date by updateTags()
+    const Akonadi::Tag::List tags = item.tags();
+    for (const Akonadi::Tag &tag : tags) {
+        m_doc->add_boolean_term(tagTerm(tag));
+    }
+
+    if (m_trigrams) {
+        insertTrigrams();
+    }
+
+    // The contacts of the previous version of the item are not referenced by it anymore
+    releaseContacts(item.id());
+    std::string contactIds;
+    contactIds.reserve(m_messageContacts.size() * 4);
+    for (const Xapian::docid id : std::as_const(m_messageContacts)) {
+        char bytes[4];
+        qToBigEndian<quint32>(id, bytes);
+        contactIds.append(bytes, 4);
+    }
+    m_doc->add_value(ContactIdsSlot, contactIds);
 
     m_db->replace_document(item.id(), *m_doc);
+    m_topTerms.noteDocument(*m_doc);
+
+    // Extractions still running for a previous version of the item are stale now
+    if (!m_pendingAttachments.isEmpty()) {
+        const quint64 generation = ++m_attachmentGeneration;
+        m_attachmentGenerations.insert(item.id(), generation);
+        m_attachmentExtractor->extract(item.id(), generation, std::exchange(m_pendingAttachments, {}));
+    } else {
+        m_attachmentGenerations.remove(item.id());
+    }
 
     delete m_doc;
     delete m_termGen;
@@ -135,6 +277,81 @@ QString prettyAddress(const KMime::Types::Mailbox &mbox)
     const QByteArray email = mbox.address().simplified().toLower();
     return KEmailAddress::normalizedAddress(name, QString::fromUtf8(email));
 }
+
+// The domain an organization registered, "example.co.uk" for "mail.example.co.uk".
+// Without a public suffix list, two letter country domains with a generic
+// second level are assumed to be a suffix.
+QByteArray registrableDomain(const QByteArray &domain)
+{
+    static const QByteArrayList genericSecondLevels = {"ac", "co", "com", "edu", "gov", "ne", "net", "or", "org"};
+
+    const QByteArrayList labels = domain.split('.');
+    qsizetype count = 2;
+    if (labels.size() > 2 && labels.constLast().size() == 2 && genericSecondLevels.contains(labels.at(labels.size() - 2))) {
+        count = 3;
+    }
+    if (labels.size() <= count) {
+        return domain;
+    }
+    return labels.mid(labels.size() - count).join('.');
+}
+}
+
+void EmailIndexer::insertThreadTerms(KMime::Message *msg)
+{
+    auto insertId = [this](const char *prefix, const QByteArray &id) {
+        // Xapian's limit on the length of a term
+        if (!id.isEmpty() && id.size() < 240) {
+            m_doc->add_boolean_term(prefix + id.toStdString());
+        }
+    };
+
+    QByteArray messageId;
+    if (const KMime::Headers::MessageID *header = msg->messageID(KMime::DontCreate)) {
+        messageId = header->identifier();
+        insertId("XMI:", messageId);
+    }
+
+    QByteArray root;
+    if (const KMime::Headers::References *header = msg->references(KMime::DontCreate)) {
+        const QList<QByteArray> ids = header->identifiers();
+        for (const QByteArray &id : ids) {
+            insertId("XRF:", id);
+        }
+        if (!ids.isEmpty()) {
+            root = ids.constFirst();
+        }
+    }
+    if (const KMime::Headers::InReplyTo *header = msg->inReplyTo(KMime::DontCreate)) {
+        const QList<QByteArray> ids = header->identifiers();
+        for (const QByteArray &id : ids) {
+            insertId("XIR:", id);
+        }
+        if (root.isEmpty() && !ids.isEmpty()) {
+            root = ids.constFirst();
+        }
+    }
+
+    // The oldest known ancestor, or the message itself when it starts a thread
+    insertId("XTR:", root.isEmpty() ? messageId : root);
+}
+
+void EmailIndexer::insertAddressTerms(const std::string &key, const QByteArray &address)
+{
+    using Akonadi::Search::AddressTermKind;
+    using Akonadi::Search::addressTerm;
+
+    const QByteArray lowerAddress = address.toLower();
+    const qsizetype at = lowerAddress.lastIndexOf('@');
+    m_doc->add_boolean_term(addressTerm(AddressTermKind::Address, key, lowerAddress.toStdString()));
+    if (at <= 0 || at == lowerAddress.size() - 1) {
+        return;
+    }
+
+    const QByteArray domain = lowerAddress.mid(at + 1);
+    m_doc->add_boolean_term(addressTerm(AddressTermKind::LocalPart, key, lowerAddress.left(at).toStdString()));
+    m_doc->add_boolean_term(addressTerm(AddressTermKind::Domain, key, domain.toStdString()));
+    m_doc->add_boolean_term(addressTerm(AddressTermKind::RegistrableDomain, key, registrableDomain(domain).toStdString()));
 }
 
 // Add once with a prefix and once without
@@ -143,43 +360,194 @@ void EmailIndexer::insert(const QByteArray &key, const QList<KMime::Types::Mailb
     if (!m_contactDb) {
         return;
     }
+    const std::string prefix(key.constData(), key.size());
     for (const KMime::Types::Mailbox &mbox : list) {
         const auto name(mbox.name().toStdString());
-        m_termGen->index_text_without_positions(name, 1, key.data());
+        m_termGen->index_text_without_positions(name, 1, prefix);
         m_termGen->index_text_without_positions(name, 1);
-        m_termGen->index_text_without_positions(mbox.address().data(), 1, key.data());
-        m_termGen->index_text_without_positions(mbox.address().data(), 1);
+        if (m_headerBigrams) {
+            insertBigrams(name, prefix);
+        }
+
+        // The address already is UTF-8, let Xapian read it in place
+        const QByteArray address = mbox.address();
+        const Xapian::Utf8Iterator addressIt(address.constData(), address.size());
+        m_termGen->index_text_without_positions(addressIt, 1, prefix);
+        m_termGen->index_text_without_positions(addressIt, 1);
+        if (m_headerBigrams) {
+            insertBigrams(std::string_view(address.constData(), address.size()), prefix);
+        }
+
+        const std::string addressTerm(address.constData(), address.size());
+        m_doc->add_term(prefix + addressTerm);
+        m_doc->add_term(addressTerm);
 
-        m_doc->add_term(QByteArray(key + mbox.address()).data());
-        m_doc->add_term(mbox.address().data());
+        // Exact address, domain and local part filters are single terms
+        insertAddressTerms(prefix, address);
 
         //
         // Add emails for email auto-completion
         //
-        const auto pa = prettyAddress(mbox);
-        const auto id = qHash(pa);
+        insertContact(mbox);
+    }
+}
+
+void EmailIndexer::insertContact(const KMime::Types::Mailbox &mbox)
+{
+    const auto pa = prettyAddress(mbox);
+    const Xapian::docid id = qHash(pa);
+    // A message counts once per contact
+    if (m_messageContacts.contains(id)) {
+        return;
+    }
+    m_messageContacts.insert(id);
+
+    Xapian::Document doc;
+    double frequency = 0;
+    double lastSeen = 0;
+    try {
+        doc = m_contactDb->get_document(id);
+        frequency = contactValue(doc, ContactFrequencySlot);
+        lastSeen = contactValue(doc, ContactLastSeenSlot);
+    } catch (const Xapian::DocNotFoundError &) {
+        const auto pretty(pa.toStdString());
+        doc.set_data(pretty);
+
+        Xapian::TermGenerator termGen;
+        termGen.set_document(doc);
+        termGen.index_text(pretty);
+
+        doc.add_term(mbox.address().data());
+        // Completions with the same address are collapsed on this value
+        doc.add_value(ContactAddressSlot, mbox.address().toLower().toStdString());
+    }
+
+    // How often and how recently we corresponded, to rank completions
+    doc.add_value(ContactFrequencySlot, Xapian::sortable_serialise(frequency + 1));
+    doc.add_value(ContactLastSeenSlot, Xapian::sortable_serialise(std::max<double>(lastSeen, m_messageTime)));
+    m_contactDb->replace_document(id, doc);
+    m_changedContacts.push_back(id);
+}
+
+void EmailIndexer::releaseContacts(Xapian::docid emailId)
+{
+    if (!m_contactDb) {
+        return;
+    }
+
+    std::string ids;
+    try {
+        ids = m_db->get_document(emailId).get_value(ContactIdsSlot);
+    } catch (const Xapian::DocNotFoundError &) {
+        return;
+    }
+
+    for (std::size_t pos = 0; pos + 4 <= ids.size(); pos += 4) {
+        const auto id = qFromBigEndian<quint32>(ids.data() + pos);
+        Xapian::Document doc;
         try {
-            const auto doc = m_contactDb->get_document(id);
-            Q_UNUSED(doc);
-            continue;
+            doc = m_contactDb->get_document(id);
         } catch (const Xapian::DocNotFoundError &) {
-            Xapian::Document doc;
-            const auto pretty(pa.toStdString());
-            doc.set_data(pretty);
+            continue;
+        }
+        // The message may be indexed again, it must not count twice
+        const double frequency = std::max(0.0, contactValue(doc, ContactFrequencySlot) - 1);
+        doc.add_value(ContactFrequencySlot, Xapian::sortable_serialise(frequency));
+        m_contactDb->replace_document(id, doc);
+        m_changedContacts.push_back(id);
+        if (frequency <= 0) {
+            m_scanUnreferencedContacts = true;
+        }
+    }
+}
+
+void EmailIndexer::compactContacts()
+{
+    std::vector<Xapian::docid> ids;
 
-            Xapian::TermGenerator termGen;
-            termGen.set_document(doc);
-            termGen.index_text(pretty);
+    // Contacts may have been referenced again since they were released, ask the
+    // database.
+    if (m_scanUnreferencedContacts) {
+        m_scanUnreferencedContacts = false;
+        Xapian::Enquire enquire(*m_contactDb);
+        enquire.set_query(Xapian::Query(Xapian::Query::OP_VALUE_LE, ContactFrequencySlot, Xapian::sortable_serialise(0)));
+        enquire.set_weighting_scheme(Xapian::BoolWeight());
+        enquire.set_docid_order(Xapian::Enquire::ASCENDING);
+        const Xapian::MSet mset = enquire.get_mset(0, m_contactDb->get_doccount());
+        for (auto it = mset.begin(), end = mset.end(); it != end; ++it) {
+            ids.push_back(*it);
+        }
+    }
 
-            doc.add_term(mbox.address().data());
-            m_contactDb->replace_document(id, doc);
+    // Looking for expired contacts means reading all of them, do it once a day.
+    // Only contacts without references expire: a contact deleted while messages
+    // refer to it would have its references released from the contact replacing it.
+    const int expiryDays = m_policy.contactExpiryDays();
+    if (expiryDays > 0 && (!m_contactExpiryTimer.isValid() || m_contactExpiryTimer.hasExpired(24 * 3600 * 1000))) {
+        m_contactExpiryTimer.start();
+        const double expiry = static_cast<double>(QDateTime::currentSecsSinceEpoch()) - expiryDays * 24.0 * 3600.0;
+        for (auto it = m_contactDb->valuestream_begin(ContactLastSeenSlot), end = m_contactDb->valuestream_end(ContactLastSeenSlot); it != end; ++it) {
+            if (Xapian::sortable_unserialise(*it) < expiry && contactValue(m_contactDb->get_document(it.get_docid()), ContactFrequencySlot) <= 0) {
+                ids.push_back(it.get_docid());
+            }
         }
     }
+
+    if (ids.empty()) {
+        return;
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    for (const Xapian::docid id : ids) {
+        m_contactDb->delete_document(id);
+    }
+    m_changedContacts.insert(m_changedContacts.end(), ids.cbegin(), ids.cend());
+    qCDebug(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Dropped" << ids.size() << "unreferenced or expired contacts";
+}
+
+void EmailIndexer::logContactChanges()
+{
+    // Nothing is committed without changes, the revision stays the same
+    if (m_changedContacts.empty()) {
+        return;
+    }
+
+    std::sort(m_changedContacts.begin(), m_changedContacts.end());
+    m_changedContacts.erase(std::unique(m_changedContacts.begin(), m_changedContacts.end()), m_changedContacts.end());
+
+    // The revision the commit creates
+    const Xapian::rev revision = m_contactDb->get_revision() + 1;
+    m_contactDb->set_metadata(Akonadi::Search::contactChangesKey(revision), Akonadi::Search::serializeContactIds(m_changedContacts));
+    if (revision > Akonadi::Search::MaxContactChangeRevisions) {
+        m_contactDb->set_metadata(Akonadi::Search::contactChangesKey(revision - Akonadi::Search::MaxContactChangeRevisions), {});
+    }
+    m_changedContacts.clear();
 }
 
 // FIXME: Only index properties that are actually searched!
-void EmailIndexer::process(const std::shared_ptr<KMime::Message> &msg)
+void EmailIndexer::process(const std::shared_ptr<KMime::Message> &msg, IndexingTier tier)
 {
+    m_pendingAttachments.clear();
+
+    KMime::Headers::Date *date = msg->date(KMime::DontCreate);
+    m_messageTime = date ? date->dateTime().toSecsSinceEpoch() : 0;
+    if (date) {
+        // Numeric values compare correctly only when sortable_serialise()d
+        m_doc->add_value(0, Xapian::sortable_serialise(date->dateTime().toSecsSinceEpoch()));
+        m_doc->add_value(2, Xapian::sortable_serialise(date->dateTime().date().toJulianDay()));
+
+        // Year, month and day terms back Query::setDateFilter()
+        const QDate day = date->dateTime().date();
+        if (day.isValid()) {
+            m_doc->add_boolean_term(Akonadi::Search::XapianDocument::dateTerm(day.year()));
+            m_doc->add_boolean_term(Akonadi::Search::XapianDocument::dateTerm(day.year(), day.month()));
+            m_doc->add_boolean_term(Akonadi::Search::XapianDocument::dateTerm(day.year(), day.month(), day.day()));
+        }
+    }
+
+    // Old messages may be demoted to a cheaper tier
+    tier = m_policy.tierForDate(date ? date->dateTime() : QDateTime(), tier);
+
     //
     // Process Headers
     // (Give the subject a higher priority)
@@ -187,17 +555,17 @@ void EmailIndexer::process(const std::shared_ptr<KMime::Message> &msg)
     if (subject) {
         const std::string str{normalizeString(subject->asUnicodeString()).toStdString()};
         qCDebug(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Indexing" << str.c_str();
+        m_doc->set_data(str);
+        if (tier == IndexingTier::MetadataOnly) {
+            return;
+        }
         m_termGen->index_text_without_positions(str, 1, "SU");
         m_termGen->index_text_without_positions(str, 100);
-        m_doc->set_data(str);
-    }
-
-    KMime::Headers::Date *date = msg->date(KMime::DontCreate);
-    if (date) {
-        const QString str = QString::number(date->dateTime().toSecsSinceEpoch());
-        m_doc->add_value(0, str.toStdString());
-        const QString julianDay = QString::number(date->dateTime().date().toJulianDay());
-        m_doc->add_value(2, julianDay.toStdString());
+        if (m_headerBigrams) {
+            insertBigrams(str, "SU");
+        }
+    } else if (tier == IndexingTier::MetadataOnly) {
+        return;
     }
 
     insert("F", msg->from(KMime::DontCreate));
@@ -212,63 +580,239 @@ void EmailIndexer::process(const std::shared_ptr<KMime::Message> &msg)
     insert("XML", msg->headerByType("X-Mailing-List"));
     insert("XSF", msg->headerByType("X-Spam-Flag"));
 
+    // Thread structure, as exact terms
+    insertThreadTerms(msg.get());
+
     //
     // Process Plain Text Content
     //
 
     // Index all headers
-    m_termGen->index_text_without_positions(std::string(msg->head().constData()), 1, "HE");
+    const QByteArray head = msg->head();
+    m_termGen->index_text_without_positions(Xapian::Utf8Iterator(head.constData(), head.size()), 1, "HE");
 
-    KMime::Content *mainBody = msg->mainBodyPart("text/plain");
-    if (mainBody) {
-        const std::string text(normalizeString(mainBody->decodedText()).toStdString());
-        m_termGen->index_text_without_positions(text);
-        m_termGen->index_text_without_positions(text, 1, "BO");
-    } else {
-        processPart(msg.get(), nullptr);
+    if (tier == IndexingTier::HeadersOnly) {
+        return;
     }
+
+    // Only look at the MIME structure now, and only decode the part we index
+    KMime::Content *textPart = nullptr;
+    KMime::Content *htmlPart = nullptr;
+    findBodyParts(msg.get(), msg.get(), textPart, htmlPart, 0);
+
+    if (textPart) {
+        // The encoded size bounds the decoded one, refuse huge parts before decoding them
+        if (!withinBudget(textPart->body().size(), 1)) {
+            return;
+        }
+        indexBody(textPart);
+    } else if (htmlPart) {
+        // Only get HTML content, if no plain text content
+        processHtmlPart(htmlPart);
+    }
+
+    processAttachments(msg.get());
 }
 
-void EmailIndexer::processPart(KMime::Content *content, KMime::Content *mainContent)
+void EmailIndexer::indexBody(KMime::Content *textPart)
 {
-    if (content == mainContent) {
+    const KMime::Headers::ContentType *type = textPart->contentType(KMime::DontCreate);
+    const QByteArray charset = type ? type->charset().toLower() : QByteArray();
+    const QByteArray body = textPart->decodedBody();
+
+    // UTF-8 and ASCII bodies go straight from the decoded bytes to Xapian,
+    // unless they need to be normalized
+    if ((charset.isEmpty() || charset == "utf-8" || charset == "us-ascii") && (mRespectDiacriticAndAccents || isAscii(body))) {
+        indexBodyText(std::string_view(body.constData(), body.size()));
         return;
     }
 
-    KMime::Headers::ContentType *type = content->contentType(KMime::DontCreate);
-    if (type) {
-        if (type->isMultipart()) {
-            if (type->isSubtype("encrypted")) {
-                return;
-            }
+    const std::string text(normalizeString(textPart->decodedText()).toStdString());
+    indexBodyText(text);
+}
 
-            for (KMime::Content *c : content->contents()) {
-                processPart(c, mainContent);
+void EmailIndexer::indexBodyText(std::string_view text)
+{
+    // A single huge body must not run past the time budget of the item
+    while (!text.empty()) {
+        std::string_view chunk = text.substr(0, BodyChunkSize);
+        if (chunk.size() < text.size()) {
+            // Cut at a space, so no word is split. Without one, at least
+            // cut before a UTF-8 lead byte so no sequence is split.
+            const std::size_t space = chunk.find_last_of(" \t\r\n");
+            if (space != std::string_view::npos && space > 0) {
+                chunk = chunk.substr(0, space + 1);
+            } else {
+                std::size_t cut = chunk.size();
+                while (cut > 0 && (static_cast<unsigned char>(text[cut]) & 0xC0) == 0x80) {
+                    --cut;
+                }
+                if (cut > 0) {
+                    chunk = chunk.substr(0, cut);
+                }
             }
         }
+        text.remove_prefix(chunk.size());
 
-        // Only get HTML content, if no plain text content
-        if (!mainContent && type->isHTMLText()) {
-            QProcess converter;
-            converter.start(u"akonadi_html_to_text"_s);
-            if (!converter.waitForStarted()) {
-                return;
-            }
+        const Xapian::Utf8Iterator it(chunk.data(), chunk.size());
+        m_termGen->index_text_without_positions(it);
+        m_termGen->index_text_without_positions(it, 1, "BO");
+        if (m_bodyBigrams) {
+            insertBigrams(chunk, "BO");
+        }
+
+        if (!text.empty() && !withinBudget(0, 0)) {
+            return;
+        }
+    }
+}
+
+void EmailIndexer::findBodyParts(KMime::Content *content, KMime::Content *root, KMime::Content *&textPart, KMime::Content *&htmlPart, int depth)
+{
+    if (textPart || !withinBudget(0, depth)) {
+        return;
+    }
 
-            converter.write(content->decodedText().toUtf8());
-            converter.closeWriteChannel();
+    // Attachment bodies are never needed, don't even walk into them
+    if (content != root) {
+        const KMime::Headers::ContentDisposition *disposition = content->contentDisposition(KMime::DontCreate);
+        if (disposition && disposition->disposition() == KMime::Headers::CDattachment) {
+            return;
+        }
+    }
 
-            if (!converter.waitForFinished()) {
+    const KMime::Headers::ContentType *type = content->contentType(KMime::DontCreate);
+    // No Content-Type means text/plain
+    if (!type || type->isPlainText()) {
+        textPart = content;
+        return;
+    }
+
+    if (type->isMultipart()) {
+        if (type->isSubtype("encrypted")) {
+            return;
+        }
+
+        for (KMime::Content *c : content->contents()) {
+            findBodyParts(c, root, textPart, htmlPart, depth + 1);
+            if (textPart || !m_budgetExceeded.isEmpty()) {
                 return;
             }
+        }
+    } else if (!htmlPart && type->isHTMLText()) {
+        htmlPart = content;
+    }
+}
+
+void EmailIndexer::processHtmlPart(KMime::Content *content)
+{
+    if (!withinBudget(content->body().size(), 1)) {
+        return;
+    }
 
-            const auto text = converter.readAll().toStdString();
+    QProcess converter;
+    converter.start(u"akonadi_html_to_text"_s);
+    if (!converter.waitForStarted()) {
+        return;
+    }
 
-            m_termGen->index_text_without_positions(text);
+    converter.write(content->decodedText().toUtf8());
+    converter.closeWriteChannel();
+
+    // Don't let the converter run past the time budget of the item
+    const qint64 maxTime = m_policy.maxIndexingTimePerItem();
+    const int timeout = maxTime > 0 ? int(std::max<qint64>(maxTime - m_itemTimer.elapsed(), 1)) : 30000;
+    if (!converter.waitForFinished(timeout)) {
+        if (converter.state() != QProcess::NotRunning) {
+            converter.kill();
+            converter.waitForFinished();
+            m_budgetExceeded = u"HTML conversion timed out"_s;
         }
+        return;
     }
 
-    // FIXME: Handle attachments?
+    const auto text = converter.readAll().toStdString();
+
+    m_termGen->index_text_without_positions(text);
+}
+
+void EmailIndexer::processAttachments(KMime::Content *root)
+{
+    if (!m_budgetExceeded.isEmpty()) {
+        return;
+    }
+
+    const qint64 maxBytes = m_policy.maxAttachmentBytes();
+    qint64 remainingBytes = m_policy.maxAttachmentBytesPerItem();
+    const auto attachments = root->attachments();
+    for (KMime::Content *attachment : attachments) {
+        // Name and type are cheap, always index them
+        const KMime::Headers::ContentType *type = attachment->contentType(KMime::DontCreate);
+        const QByteArray mimeType = type ? type->mimeType().toLower() : QByteArrayLiteral("text/plain");
+        m_doc->add_boolean_term("AM" + mimeType.toStdString());
+
+        QString fileName;
+        if (const KMime::Headers::ContentDisposition *disposition = attachment->contentDisposition(KMime::DontCreate)) {
+            fileName = disposition->filename();
+        }
+        if (fileName.isEmpty() && type) {
+            fileName = type->name();
+        }
+        if (!fileName.isEmpty()) {
+            m_termGen->index_text_without_positions(normalizeString(fileName).toStdString(), 1, "AN");
+        }
+
+        if (!isTextAttachment(mimeType) || remainingBytes <= 0) {
+            continue;
+        }
+
+        // Skip attachments way past the limit. The others go to the extractor
+        // still encoded, so they are decoded without slowing down the indexing of the item
+        const qint64 limit = maxBytes > 0 ? std::min(maxBytes, remainingBytes) : remainingBytes;
+        const QByteArray body = attachment->encodedBody();
+        if (body.size() > 2 * limit) {
+            qCDebug(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Skipping text of attachment" << fileName << "of" << body.size() << "bytes";
+            continue;
+        }
+
+        AttachmentExtractor::Attachment extracted;
+        extracted.data = body;
+        extracted.encoding = transferEncoding(attachment);
+        extracted.charset = type ? type->charset() : QByteArray();
+        extracted.limit = limit;
+        // The encoded size bounds the decoded one
+        remainingBytes -= std::min<qint64>(body.size(), limit);
+        m_pendingAttachments.append(std::move(extracted));
+    }
+}
+
+void EmailIndexer::applyAttachmentResults()
+{
+    const auto results = m_attachmentExtractor->takeResults();
+    if (results.empty()) {
+        return;
+    }
+
+    for (const AttachmentExtractor::Result &result : results) {
+        // The item was indexed again or removed since the extraction was queued
+        const auto generation = m_attachmentGenerations.constFind(result.id);
+        if (generation == m_attachmentGenerations.cend() || *generation != result.generation) {
+            continue;
+        }
+        m_attachmentGenerations.erase(generation);
+
+        try {
+            Xapian::Document doc = m_db->get_document(result.id);
+            for (const auto &[term, wdf] : result.terms) {
+                doc.add_term(term, wdf);
+            }
+            m_db->replace_document(result.id, doc);
+            m_topTerms.noteDocument(doc);
+        } catch (const Xapian::DocNotFoundError &) {
+            // Removed in the meantime
+        }
+    }
+    qCDebug(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Attachment extraction:" << m_attachmentExtractor->statistics();
 }
 
 void EmailIndexer::processMessageStatus(Akonadi::MessageStatus status)
@@ -303,6 +847,108 @@ void EmailIndexer::insertBool(char key, bool value)
     m_doc->add_boolean_term(term.data());
 }
 
+void EmailIndexer::insertBigrams(std::string_view text, std::string_view prefix)
+{
+    for (const std::string &term : Akonadi::Search::XapianTermGenerator::bigramTerms(text, prefix)) {
+        m_doc->add_boolean_term(term);
+    }
+}
+
+void EmailIndexer::insertTrigrams()
+{
+    // Derived from the terms themselves, so searches can verify candidates against them.
+    // Addresses are also kept as raw-case terms, trigrams and searches are lowercase.
+    // No other prefix of email documents starts with one of these, only the
+    // "BC" flag term equals one.
+    static const std::string prefixes[] = {"SU", "F", "T", "CC", "BC", "RT"};
+    std::vector<std::string> trigrams;
+    for (const std::string &prefix : prefixes) {
+        auto it = m_doc->termlist_begin();
+        const auto end = m_doc->termlist_end();
+        for (it.skip_to(prefix); it != end; ++it) {
+            const std::string term = *it;
+            if (term.compare(0, prefix.size(), prefix) != 0) {
+                break;
+            }
+            if (term.size() == prefix.size()) {
+                continue;
+            }
+            const std::string word = Xapian::Unicode::tolower(term.substr(prefix.size()));
+            const auto wordTrigrams = Akonadi::Search::XapianTermGenerator::trigramTerms(word, prefix);
+            trigrams.insert(trigrams.end(), wordTrigrams.begin(), wordTrigrams.end());
+        }
+    }
+
+    for (const std::string &trigram : trigrams) {
+        m_doc->add_boolean_term(trigram);
+    }
+}
+
+void EmailIndexer::updateTermMetadata()
+{
+    if (!m_db) {
+        return;
+    }
+
+    const QByteArrayList headerPrefixes = {"SU", "F", "T", "CC", "BC", "RT"};
+    QByteArrayList bigramPrefixes;
+    if (m_policy.phraseBigrams()) {
+        bigramPrefixes << headerPrefixes;
+    }
+    if (m_policy.bodyPhraseBigrams()) {
+        bigramPrefixes << "BO";
+    }
+    m_headerBigrams = m_policy.phraseBigrams();
+    m_bodyBigrams = m_policy.bodyPhraseBigrams();
+    m_trigrams = m_policy.substringTrigrams();
+
+    updatePrefixMetadata(Akonadi::Search::XapianTermGenerator::bigramMetadataKey, bigramPrefixes);
+    updatePrefixMetadata(Akonadi::Search::XapianTermGenerator::trigramMetadataKey, m_trigrams ? headerPrefixes : QByteArrayList());
+}
+
+void EmailIndexer::updatePrefixMetadata(const char *key, QByteArrayList prefixes)
+{
+    // Searches only use the extra terms of a prefix if every document has them.
+    // That is only true for a new database, or when they are being turned off.
+    const std::string stored = m_db->get_metadata(key);
+    if (m_db->get_doccount() > 0) {
+        const QByteArrayList storedPrefixes = QByteArray::fromStdString(stored).split(',');
+        prefixes.erase(std::remove_if(prefixes.begin(),
+                                      prefixes.end(),
+                                      [&storedPrefixes](const QByteArray &prefix) {
+                                          return !storedPrefixes.contains(prefix);
+                                      }),
+                       prefixes.end());
+    }
+
+    const std::string wanted = prefixes.join(',').toStdString();
+    if (wanted != stored) {
+        m_db->set_metadata(key, wanted);
+    }
+}
+
+bool EmailIndexer::withinBudget(qint64 bytes, int depth)
+{
+    if (!m_budgetExceeded.isEmpty()) {
+        return false;
+    }
+
+    const int maxDepth = m_policy.maxMimeDepth();
+    const qint64 maxBytes = m_policy.maxDecodedBytesPerItem();
+    const qint64 maxTime = m_policy.maxIndexingTimePerItem();
+    if (maxDepth > 0 && depth > maxDepth) {
+        m_budgetExceeded = u"MIME depth exceeds %1"_s.arg(maxDepth);
+    } else if (maxBytes > 0 && m_decodedBytes + bytes > maxBytes) {
+        m_budgetExceeded = u"Decoded size exceeds %1 bytes"_s.arg(maxBytes);
+    } else if (maxTime > 0 && m_itemTimer.elapsed() > maxTime) {
+        m_budgetExceeded = u"Indexing took more than %1 ms"_s.arg(maxTime);
+    } else {
+        m_decodedBytes += bytes;
+        return true;
+    }
+    return false;
+}
+
 void EmailIndexer::toggleFlag(Xapian::Document &doc, const char *remove, const char *add)
 {
     try {
@@ -349,14 +995,62 @@ void EmailIndexer::updateFlags(const Akonadi::Item &item, const QSet<QByteArray>
     m_db->replace_document(doc.get_docid(), doc);
 }
 
+void EmailIndexer::updateTags(const Akonadi::Item &item, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags)
+{
+    if (!m_db) {
+        return;
+    }
+    Xapian::Document doc;
+    try {
+        doc = m_db->get_document(item.id());
+    } catch (const Xapian::DocNotFoundError &) {
+        return;
+    }
+
+    for (const Akonadi::Tag &tag : removedTags) {
+        try {
+            doc.remove_term(tagTerm(tag));
+        } catch (const Xapian::InvalidArgumentError &) {
+            // The tag was not indexed, continue
+        }
+    }
+    for (const Akonadi::Tag &tag : addedTags) {
+        doc.add_boolean_term(tagTerm(tag));
+    }
+
+    m_db->replace_document(doc.get_docid(), doc);
+}
+
+void EmailIndexer::removeTag(const Akonadi::Tag &tag)
+{
+    if (!m_db) {
+        return;
+    }
+
+    const std::string term = tagTerm(tag);
+    std::vector<Xapian::docid> ids;
+    for (auto it = m_db->postlist_begin(term), end = m_db->postlist_end(term); it != end; ++it) {
+        ids.push_back(*it);
+    }
+
+    for (const Xapian::docid id : ids) {
+        Xapian::Document doc = m_db->get_document(id);
+        doc.remove_term(term);
+        m_db->replace_document(id, doc);
+    }
+}
+
 void EmailIndexer::remove(const Akonadi::Item &item)
 {
     if (!m_db) {
         return;
     }
+    unquarantine(item.id());
+    m_attachmentGenerations.remove(item.id());
     try {
+        releaseContacts(item.id());
+        m_topTerms.noteDocument(m_db->get_document(item.id()));
         m_db->delete_document(item.id());
-        // TODO remove contacts from contact db?
     } catch (const Xapian::DocNotFoundError &) {
         return;
     }
@@ -383,7 +1077,7 @@ void EmailIndexer::remove(const Akonadi::Collection &collection)
     }
 }
 
-void EmailIndexer::move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from, Akonadi::Collection::Id to)
+void EmailIndexer::move(Akonadi::Item::Id itemId, const Akonadi::Collection &from, const Akonadi::Collection &to)
 {
     if (!m_db) {
         return;
@@ -395,18 +1089,112 @@ void EmailIndexer::move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from,
         return;
     }
 
-    const QByteArray ft = 'C' + QByteArray::number(from);
-    const QByteArray tt = 'C' + QByteArray::number(to);
+    const QByteArray ft = 'C' + QByteArray::number(from.id());
+    const QByteArray tt = 'C' + QByteArray::number(to.id());
 
     doc.remove_term(ft.data());
     doc.add_boolean_term(tt.data());
+    setAncestorTerms(doc, to);
     m_db->replace_document(doc.get_docid(), doc);
 }
 
+void EmailIndexer::move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to)
+{
+    if (!m_db) {
+        return;
+    }
+
+    const std::string term = "XCA:" + std::to_string(collection.id());
+    const std::vector<Xapian::docid> ids(m_db->postlist_begin(term), m_db->postlist_end(term));
+    for (const Xapian::docid id : ids) {
+        Xapian::Document doc = m_db->get_document(id);
+        moveAncestorTerms(doc, from, to);
+        m_db->replace_document(id, doc);
+    }
+}
+
+void EmailIndexer::setIndexingPolicy(const IndexingPolicy &policy)
+{
+    m_policy = policy;
+    m_attachmentExtractor->setMaxThreadCount(policy.attachmentWorkers());
+    updateTermMetadata();
+}
+
+QHash<Akonadi::Item::Id, QString> EmailIndexer::quarantinedItems() const
+{
+    return m_quarantine;
+}
+
+void EmailIndexer::quarantine(Akonadi::Item::Id id, const QString &reason)
+{
+    if (!m_quarantine.contains(id)) {
+        // Keep the most recent offenders
+        if (m_quarantine.size() >= MaxQuarantinedItems) {
+            const Akonadi::Item::Id oldest = m_quarantineOrder.takeFirst();
+            qCWarning(AKONADI_INDEXER_AGENT_EMAIL_LOG) << "Quarantine is full, forgetting item" << oldest << "quarantined for" << m_quarantine.value(oldest);
+            m_quarantine.remove(oldest);
+        }
+        m_quarantineOrder.append(id);
+    }
+    m_quarantine.insert(id, reason);
+    m_quarantineChanged = true;
+}
+
+void EmailIndexer::unquarantine(Akonadi::Item::Id id)
+{
+    if (m_quarantine.remove(id)) {
+        m_quarantineOrder.removeOne(id);
+        m_quarantineChanged = true;
+    }
+}
+
+void EmailIndexer::loadQuarantine()
+{
+    if (!m_db) {
+        return;
+    }
+
+    const QByteArray data = QByteArray::fromStdString(m_db->get_metadata(QuarantineMetadataKey));
+    for (const QByteArray &line : data.split('\n')) {
+        const qsizetype tab = line.indexOf('\t');
+        bool ok = false;
+        const Akonadi::Item::Id id = line.left(tab).toLongLong(&ok);
+        if (tab <= 0 || !ok || m_quarantine.contains(id)) {
+            continue;
+        }
+        m_quarantine.insert(id, QString::fromUtf8(line.mid(tab + 1)));
+        m_quarantineOrder.append(id);
+    }
+}
+
+void EmailIndexer::saveQuarantine()
+{
+    if (!m_quarantineChanged) {
+        return;
+    }
+
+    QByteArray data;
+    for (const Akonadi::Item::Id id : std::as_const(m_quarantineOrder)) {
+        QString reason = m_quarantine.value(id);
+        reason.replace(u'\n', u' ');
+        data += QByteArray::number(id) + '\t' + reason.toUtf8() + '\n';
+    }
+    m_db->set_metadata(QuarantineMetadataKey, data.toStdString());
+    m_quarantineChanged = false;
+}
+
+AttachmentExtractor *EmailIndexer::attachmentExtractor() const
+{
+    return m_attachmentExtractor.get();
+}
+
 void EmailIndexer::commit()
 {
     if (m_db) {
         try {
+            applyAttachmentResults();
+            saveQuarantine();
+            m_topTerms.update(*m_db);
             m_db->commit();
         } catch (const Xapian::Error &err) {
             qCWarning(AKONADI_INDEXER_AGENT_EMAIL_LOG) << err.get_error_string();
@@ -416,6 +1204,8 @@ void EmailIndexer::commit()
 
     if (m_contactDb) {
         try {
+            compactContacts();
+            logContactChanges();
             m_contactDb->commit();
         } catch (const Xapian::Error &err) {
             qCWarning(AKONADI_INDEXER_AGENT_EMAIL_LOG) << err.get_error_string();
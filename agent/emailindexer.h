@@ -10,9 +10,14 @@
 #include <xapian.h>
 
 #include "abstractindexer.h"
+#include "attachmentextractor.h"
+#include "xapiantopterms.h"
 
 #include <Akonadi/MessageStatus>
 #include <KMime/Message>
+#include <QElapsedTimer>
+
+#include <vector>
 
 class EmailIndexer : public AbstractIndexer
 {
@@ -27,30 +32,105 @@ public:
     [[nodiscard]] QStringList mimeTypes() const override;
 
     void index(const Akonadi::Item &item) override;
+    void index(const Akonadi::Item &item, IndexingTier tier) override;
     void updateFlags(const Akonadi::Item &item, const QSet<QByteArray> &added, const QSet<QByteArray> &removed) override;
+    void updateTags(const Akonadi::Item &item, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags) override;
+    void removeTag(const Akonadi::Tag &tag) override;
     void remove(const Akonadi::Item &item) override;
     void remove(const Akonadi::Collection &item) override;
-    void move(Akonadi::Item::Id itemId, Akonadi::Collection::Id from, Akonadi::Collection::Id to) override;
+    void move(Akonadi::Item::Id itemId, const Akonadi::Collection &from, const Akonadi::Collection &to) override;
+    void move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to) override;
 
     void commit() override;
 
+    void setIndexingPolicy(const IndexingPolicy &policy);
+
+    /**
+     * Items which exceeded their indexing budget and were only indexed
+     * headers-only, with the reason.
+     *
+     * The list is stored in the database on commit(), and only keeps the
+     * most recent offenders once full.
+     */
+    [[nodiscard]] QHash<Akonadi::Item::Id, QString> quarantinedItems() const;
+
+    /**
+     * Extracts the text of attachments in the background. Its results
+     * are written to the database on the next commit().
+     */
+    [[nodiscard]] AttachmentExtractor *attachmentExtractor() const;
+
 private:
     Xapian::WritableDatabase *m_db = nullptr;
     Xapian::Document *m_doc = nullptr;
     Xapian::TermGenerator *m_termGen = nullptr;
+    // The most frequent completions of short words, updated on commit()
+    Akonadi::Search::XapianTopTerms m_topTerms;
 
     Xapian::WritableDatabase *m_contactDb = nullptr;
 
+    IndexingPolicy m_policy;
+
+    QElapsedTimer m_itemTimer;
+    qint64 m_decodedBytes = 0;
+    QString m_budgetExceeded;
+    QHash<Akonadi::Item::Id, QString> m_quarantine;
+    // Quarantined items, oldest first
+    QList<Akonadi::Item::Id> m_quarantineOrder;
+    bool m_quarantineChanged = false;
+
+    std::unique_ptr<AttachmentExtractor> m_attachmentExtractor;
+    QList<AttachmentExtractor::Attachment> m_pendingAttachments;
+    // Generation of the latest extraction queued for each item, older results are dropped
+    QHash<Akonadi::Item::Id, quint64> m_attachmentGenerations;
+    quint64 m_attachmentGeneration = 0;
+
+    bool m_headerBigrams = false;
+    bool m_bodyBigrams = false;
+    bool m_trigrams = false;
+
+    // Date of the message being processed, in seconds since epoch
+    qint64 m_messageTime = 0;
+    // Contacts of the message being processed
+    QSet<Xapian::docid> m_messageContacts;
+    // Whether a contact may have lost its last reference, they are looked up
+    // in the database on commit(). Also true after a restart.
+    bool m_scanUnreferencedContacts = true;
+    QElapsedTimer m_contactExpiryTimer;
+    // Contacts changed since the last commit, for the readers of the database
+    std::vector<Xapian::docid> m_changedContacts;
+
     void toggleFlag(Xapian::Document &doc, const char *remove, const char *add);
 
-    void process(const std::shared_ptr<KMime::Message> &msg);
-    void processPart(KMime::Content *content, KMime::Content *mainContent);
+    void process(const std::shared_ptr<KMime::Message> &msg, IndexingTier tier);
+    void findBodyParts(KMime::Content *content, KMime::Content *root, KMime::Content *&textPart, KMime::Content *&htmlPart, int depth);
+    void processHtmlPart(KMime::Content *content);
+    void processAttachments(KMime::Content *root);
+    void applyAttachmentResults();
+    void indexBody(KMime::Content *textPart);
+    void indexBodyText(std::string_view text);
     void processMessageStatus(Akonadi::MessageStatus status);
 
     void insert(const QByteArray &key, KMime::Headers::Base *base);
     void insert(const QByteArray &key, KMime::Headers::Generics::MailboxList *mlist);
     void insert(const QByteArray &key, KMime::Headers::Generics::AddressList *alist);
     void insert(const QByteArray &key, const QList<KMime::Types::Mailbox> &list);
+    void insertAddressTerms(const std::string &key, const QByteArray &address);
+    void insertContact(const KMime::Types::Mailbox &mbox);
+    void releaseContacts(Xapian::docid emailId);
+    void compactContacts();
+    void logContactChanges();
+    void insertThreadTerms(KMime::Message *msg);
 
     void insertBool(char key, bool value);
+    void insertBigrams(std::string_view text, std::string_view prefix);
+    void insertTrigrams();
+    void updateTermMetadata();
+    void updatePrefixMetadata(const char *key, QByteArrayList prefixes);
+
+    [[nodiscard]] bool withinBudget(qint64 bytes, int depth);
+    void quarantine(Akonadi::Item::Id id, const QString &reason);
+    void unquarantine(Akonadi::Item::Id id);
+    void loadQuarantine();
+    void saveQuarantine();
 };
@@ -85,7 +85,7 @@ bool Index::haveIndexerForMimeTypes(const QStringList &mimeTypes)
     return !indexersForMimetypes(mimeTypes).isEmpty();
 }
 
-void Index::index(const Akonadi::Item &item)
+void Index::index(const Akonadi::Item &item, IndexingTier tier)
 {
     auto indexer = indexerForItem(item);
     if (!indexer) {
@@ -94,7 +94,7 @@ void Index::index(const Akonadi::Item &item)
     }
 
     try {
-        indexer->index(item);
+        indexer->index(item, tier);
     } catch (const Xapian::Error &e) {
         qCWarning(AKONADI_INDEXER_AGENT_LOG) << "Xapian error in indexer" << indexer.get() << ":" << e.get_msg().c_str();
     }
@@ -109,7 +109,7 @@ void Index::move(const Akonadi::Item::List &items, const Akonadi::Collection &fr
     }
     for (const Akonadi::Item &item : items) {
         try {
-            indexer->move(item.id(), from.id(), to.id());
+            indexer->move(item.id(), from, to);
         } catch (const Xapian::Error &e) {
             qCWarning(AKONADI_INDEXER_AGENT_LOG) << "Xapian error in indexer" << indexer.get() << ":" << e.get_msg().c_str();
         }
@@ -132,6 +132,33 @@ void Index::updateFlags(const Akonadi::Item::List &items, const QSet<QByteArray>
     }
 }
 
+void Index::updateTags(const Akonadi::Item::List &items, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags)
+{
+    // We always get items of the same type
+    auto indexer = indexerForItem(items.first());
+    if (!indexer) {
+        return;
+    }
+    for (const Akonadi::Item &item : items) {
+        try {
+            indexer->updateTags(item, addedTags, removedTags);
+        } catch (const Xapian::Error &e) {
+            qCWarning(AKONADI_INDEXER_AGENT_LOG) << "Xapian error in indexer" << indexer.get() << ":" << e.get_msg().c_str();
+        }
+    }
+}
+
+void Index::removeTag(const Akonadi::Tag &tag)
+{
+    for (const std::shared_ptr<AbstractIndexer> &indexer : std::as_const(m_listIndexer)) {
+        try {
+            indexer->removeTag(tag);
+        } catch (const Xapian::Error &e) {
+            qCWarning(AKONADI_INDEXER_AGENT_LOG) << "Xapian error in indexer" << indexer.get() << ":" << e.get_msg().c_str();
+        }
+    }
+}
+
 void Index::remove(const QSet<Akonadi::Item::Id> &ids, const QStringList &mimeTypes)
 {
     const auto indexers = indexersForMimetypes(mimeTypes);
@@ -198,6 +225,15 @@ void Index::remove(const Akonadi::Collection &col)
 
 void Index::move(const Akonadi::Collection &collection, const Akonadi::Collection &from, const Akonadi::Collection &to)
 {
+    // The subtree can contain items of any type
+    for (const auto &indexer : std::as_const(m_listIndexer)) {
+        try {
+            indexer->move(collection, from, to);
+        } catch (const Xapian::Error &e) {
+            qCWarning(AKONADI_INDEXER_AGENT_LOG) << "Xapian error in indexer" << indexer.get() << ":" << e.get_msg().c_str();
+        }
+    }
+
     if (m_collectionIndexer) {
         m_collectionIndexer->move(collection, from, to);
         m_collectionIndexer->commit();
@@ -219,7 +255,11 @@ bool Index::createIndexers()
     try {
         QDir().mkpath(m_indexedItems->emailIndexingPath());
         QDir().mkpath(m_indexedItems->emailContactsIndexingPath());
-        indexer = std::make_unique<EmailIndexer>(m_indexedItems->emailIndexingPath(), m_indexedItems->emailContactsIndexingPath());
+        auto emailIndexer = std::make_unique<EmailIndexer>(m_indexedItems->emailIndexingPath(), m_indexedItems->emailContactsIndexingPath());
+        emailIndexer->setIndexingPolicy(m_indexingPolicy);
+        // Extracted attachment text gets written out with the next commit
+        connect(emailIndexer->attachmentExtractor(), &AttachmentExtractor::resultsReady, this, &Index::scheduleCommit);
+        indexer = std::move(emailIndexer);
         indexer->setRespectDiacriticAndAccents(mRespectDiacriticAndAccents);
         addIndexer(std::move(indexer));
     } catch (const Xapian::DatabaseError &e) {
@@ -305,4 +345,40 @@ void Index::setRespectDiacriticAndAccents(bool b)
     mRespectDiacriticAndAccents = b;
 }
 
+void Index::setIndexingPolicy(const IndexingPolicy &policy)
+{
+    m_indexingPolicy = policy;
+    for (const std::shared_ptr<AbstractIndexer> &indexer : std::as_const(m_listIndexer)) {
+        if (auto emailIndexer = std::dynamic_pointer_cast<EmailIndexer>(indexer)) {
+            emailIndexer->setIndexingPolicy(policy);
+        }
+    }
+}
+
+const IndexingPolicy &Index::indexingPolicy() const
+{
+    return m_indexingPolicy;
+}
+
+QHash<Akonadi::Item::Id, QString> Index::quarantinedItems() const
+{
+    QHash<Akonadi::Item::Id, QString> items;
+    for (const std::shared_ptr<AbstractIndexer> &indexer : std::as_const(m_listIndexer)) {
+        if (auto emailIndexer = std::dynamic_pointer_cast<EmailIndexer>(indexer)) {
+            items.insert(emailIndexer->quarantinedItems());
+        }
+    }
+    return items;
+}
+
+QString Index::attachmentStatistics() const
+{
+    for (const std::shared_ptr<AbstractIndexer> &indexer : std::as_const(m_listIndexer)) {
+        if (auto emailIndexer = std::dynamic_pointer_cast<EmailIndexer>(indexer)) {
+            return emailIndexer->attachmentExtractor()->statistics();
+        }
+    }
+    return {};
+}
+
 #include "moc_index.cpp"
@@ -9,6 +9,7 @@
 
 #include "abstractindexer.h"
 #include "collectionindexer.h"
+#include "indexingpolicy.h"
 #include <Akonadi/Collection>
 #include <Akonadi/Item>
 #include <QObject>
@@ -36,9 +37,11 @@ public:
     virtual void removeDatabase();
     virtual bool createIndexers();
 
-    virtual void index(const Akonadi::Item &item);
+    virtual void index(const Akonadi::Item &item, IndexingTier tier = IndexingTier::Full);
     virtual void move(const Akonadi::Item::List &items, const Akonadi::Collection &from, const Akonadi::Collection &to);
     virtual void updateFlags(const Akonadi::Item::List &items, const QSet<QByteArray> &addedFlags, const QSet<QByteArray> &removed);
+    virtual void updateTags(const Akonadi::Item::List &items, const QSet<Akonadi::Tag> &addedTags, const QSet<Akonadi::Tag> &removedTags);
+    virtual void removeTag(const Akonadi::Tag &tag);
     virtual void remove(const QSet<Akonadi::Item::Id> &ids, const QStringList &mimeTypes);
     virtual void remove(const Akonadi::Item::List &items);
 
@@ -56,6 +59,12 @@ public:
     void setOverrideDbPrefixPath(const QString &path);
 
     void setRespectDiacriticAndAccents(bool b);
+
+    void setIndexingPolicy(const IndexingPolicy &policy);
+    [[nodiscard]] const IndexingPolicy &indexingPolicy() const;
+
+    [[nodiscard]] QHash<Akonadi::Item::Id, QString> quarantinedItems() const;
+    [[nodiscard]] QString attachmentStatistics() const;
 public Q_SLOTS:
     virtual void commit();
 
@@ -69,5 +78,6 @@ private:
     Akonadi::Search::PIM::IndexedItems *const m_indexedItems;
     QTimer m_commitTimer;
     std::unique_ptr<CollectionIndexer> m_collectionIndexer = nullptr;
+    IndexingPolicy m_indexingPolicy;
     bool mRespectDiacriticAndAccents = true;
 };
@@ -0,0 +1,216 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include "indexingpolicy.h"
+#include "indexingtierattribute.h"
+
+#include <KConfigGroup>
+#include <KMime/Message>
+
+#include <algorithm>
+
+IndexingPolicy::IndexingPolicy() = default;
+
+void IndexingPolicy::load(const KConfigGroup &cfg)
+{
+    const auto headersOnly = cfg.readEntry("headersOnlyCollections", QList<Akonadi::Collection::Id>());
+    m_headersOnlyCollections = QSet<Akonadi::Collection::Id>(headersOnly.begin(), headersOnly.end());
+    const auto metadataOnly = cfg.readEntry("metadataOnlyCollections", QList<Akonadi::Collection::Id>());
+    m_metadataOnlyCollections = QSet<Akonadi::Collection::Id>(metadataOnly.begin(), metadataOnly.end());
+    m_headersOnlyAfterDays = cfg.readEntry("headersOnlyAfterDays", 0);
+    m_metadataOnlyAfterDays = cfg.readEntry("metadataOnlyAfterDays", 0);
+    m_maxIndexingTimePerItem = cfg.readEntry("maxIndexingTimePerItem", m_maxIndexingTimePerItem);
+    m_maxDecodedBytesPerItem = cfg.readEntry("maxDecodedBytesPerItem", m_maxDecodedBytesPerItem);
+    m_maxMimeDepth = cfg.readEntry("maxMimeDepth", m_maxMimeDepth);
+    m_maxAttachmentBytes = cfg.readEntry("maxAttachmentBytes", m_maxAttachmentBytes);
+    m_maxAttachmentBytesPerItem = cfg.readEntry("maxAttachmentBytesPerItem", m_maxAttachmentBytesPerItem);
+    m_attachmentWorkers = cfg.readEntry("attachmentWorkers", m_attachmentWorkers);
+    m_phraseBigrams = cfg.readEntry("phraseBigrams", m_phraseBigrams);
+    m_bodyPhraseBigrams = cfg.readEntry("bodyPhraseBigrams", m_bodyPhraseBigrams);
+    m_substringTrigrams = cfg.readEntry("substringTrigrams", m_substringTrigrams);
+    m_contactExpiryDays = cfg.readEntry("contactExpiryDays", m_contactExpiryDays);
+}
+
+IndexingTier IndexingPolicy::tierForCollection(const Akonadi::Collection &collection) const
+{
+    // Only emails know how to be indexed partially
+    if (!collection.contentMimeTypes().isEmpty() && !collection.contentMimeTypes().contains(KMime::Message::mimeType())) {
+        return IndexingTier::Full;
+    }
+
+    if (const auto attr = collection.attribute<IndexingTierAttribute>()) {
+        return attr->tier();
+    }
+    if (m_metadataOnlyCollections.contains(collection.id())) {
+        return IndexingTier::MetadataOnly;
+    }
+    if (m_headersOnlyCollections.contains(collection.id())) {
+        return IndexingTier::HeadersOnly;
+    }
+    return IndexingTier::Full;
+}
+
+IndexingTier IndexingPolicy::tierForDate(const QDateTime &dateTime, IndexingTier collectionTier) const
+{
+    if (!dateTime.isValid() || (m_headersOnlyAfterDays <= 0 && m_metadataOnlyAfterDays <= 0)) {
+        return collectionTier;
+    }
+
+    const qint64 age = dateTime.daysTo(QDateTime::currentDateTimeUtc());
+    IndexingTier tier = IndexingTier::Full;
+    if (m_metadataOnlyAfterDays > 0 && age >= m_metadataOnlyAfterDays) {
+        tier = IndexingTier::MetadataOnly;
+    } else if (m_headersOnlyAfterDays > 0 && age >= m_headersOnlyAfterDays) {
+        tier = IndexingTier::HeadersOnly;
+    }
+    return std::max(tier, collectionTier);
+}
+
+void IndexingPolicy::setCollectionTier(Akonadi::Collection::Id id, IndexingTier tier)
+{
+    m_headersOnlyCollections.remove(id);
+    m_metadataOnlyCollections.remove(id);
+    if (tier == IndexingTier::HeadersOnly) {
+        m_headersOnlyCollections.insert(id);
+    } else if (tier == IndexingTier::MetadataOnly) {
+        m_metadataOnlyCollections.insert(id);
+    }
+}
+
+void IndexingPolicy::setHeadersOnlyAfterDays(int days)
+{
+    m_headersOnlyAfterDays = days;
+}
+
+void IndexingPolicy::setMetadataOnlyAfterDays(int days)
+{
+    m_metadataOnlyAfterDays = days;
+}
+
+qint64 IndexingPolicy::maxIndexingTimePerItem() const
+{
+    return m_maxIndexingTimePerItem;
+}
+
+void IndexingPolicy::setMaxIndexingTimePerItem(qint64 msecs)
+{
+    m_maxIndexingTimePerItem = msecs;
+}
+
+qint64 IndexingPolicy::maxDecodedBytesPerItem() const
+{
+    return m_maxDecodedBytesPerItem;
+}
+
+void IndexingPolicy::setMaxDecodedBytesPerItem(qint64 bytes)
+{
+    m_maxDecodedBytesPerItem = bytes;
+}
+
+int IndexingPolicy::maxMimeDepth() const
+{
+    return m_maxMimeDepth;
+}
+
+void IndexingPolicy::setMaxMimeDepth(int depth)
+{
+    m_maxMimeDepth = depth;
+}
+
+qint64 IndexingPolicy::maxAttachmentBytes() const
+{
+    return m_maxAttachmentBytes;
+}
+
+void IndexingPolicy::setMaxAttachmentBytes(qint64 bytes)
+{
+    m_maxAttachmentBytes = bytes;
+}
+
+qint64 IndexingPolicy::maxAttachmentBytesPerItem() const
+{
+    return m_maxAttachmentBytesPerItem;
+}
+
+void IndexingPolicy::setMaxAttachmentBytesPerItem(qint64 bytes)
+{
+    m_maxAttachmentBytesPerItem = bytes;
+}
+
+int IndexingPolicy::attachmentWorkers() const
+{
+    return m_attachmentWorkers;
+}
+
+void IndexingPolicy::setAttachmentWorkers(int count)
+{
+    m_attachmentWorkers = count;
+}
+
+bool IndexingPolicy::phraseBigrams() const
+{
+    return m_phraseBigrams;
+}
+
+void IndexingPolicy::setPhraseBigrams(bool enabled)
+{
+    m_phraseBigrams = enabled;
+}
+
+bool IndexingPolicy::bodyPhraseBigrams() const
+{
+    return m_bodyPhraseBigrams;
+}
+
+void IndexingPolicy::setBodyPhraseBigrams(bool enabled)
+{
+    m_bodyPhraseBigrams = enabled;
+}
+
+bool IndexingPolicy::substringTrigrams() const
+{
+    return m_substringTrigrams;
+}
+
+void IndexingPolicy::setSubstringTrigrams(bool enabled)
+{
+    m_substringTrigrams = enabled;
+}
+
+int IndexingPolicy::contactExpiryDays() const
+{
+    return m_contactExpiryDays;
+}
+
+void IndexingPolicy::setContactExpiryDays(int days)
+{
+    m_contactExpiryDays = days;
+}
+
+QByteArray IndexingPolicy::tierToString(IndexingTier tier)
+{
+    switch (tier) {
+    case IndexingTier::HeadersOnly:
+        return QByteArrayLiteral("headers");
+    case IndexingTier::MetadataOnly:
+        return QByteArrayLiteral("metadata");
+    case IndexingTier::Full:
+        break;
+    }
+    return QByteArrayLiteral("full");
+}
+
+IndexingTier IndexingPolicy::tierFromString(const QByteArray &str)
+{
+    if (str == "headers") {
+        return IndexingTier::HeadersOnly;
+    } else if (str == "metadata") {
+        return IndexingTier::MetadataOnly;
+    }
+    return IndexingTier::Full;
+}
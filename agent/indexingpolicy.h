@@ -0,0 +1,107 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <Akonadi/Collection>
+#include <QDateTime>
+#include <QSet>
+
+class KConfigGroup;
+
+/**
+ * How much of an item ends up in the index.
+ *
+ * Full indexes headers and body, HeadersOnly skips the body and
+ * MetadataOnly only keeps flags, collection, date and size.
+ * Lower tiers only need the header part of the payload.
+ */
+enum class IndexingTier : quint8 {
+    Full = 0,
+    HeadersOnly,
+    MetadataOnly,
+};
+
+/**
+ * Resolves the indexing tier of a collection or a message.
+ *
+ * The tier of a collection comes from its IndexingTierAttribute, or from
+ * the "headersOnlyCollections" and "metadataOnlyCollections" entries of the
+ * agent config. Old messages can be demoted further by age with
+ * "headersOnlyAfterDays" and "metadataOnlyAfterDays" (0 disables it).
+ *
+ * It also holds the per-item budgets ("maxIndexingTimePerItem" in ms,
+ * "maxDecodedBytesPerItem" and "maxMimeDepth", 0 meaning unlimited).
+ * Items exceeding them are indexed headers-only and quarantined.
+ *
+ * Text-like attachments are extracted up to "maxAttachmentBytes" each and
+ * "maxAttachmentBytesPerItem" per message, by "attachmentWorkers" threads.
+ *
+ * "phraseBigrams" adds word bigram terms to subjects and addresses, and
+ * "bodyPhraseBigrams" to bodies, so phrases can be searched without positions.
+ * "substringTrigrams" adds trigram terms to subjects and addresses, so they
+ * can be searched for substrings.
+ *
+ * Completion contacts no message refers to anymore are dropped. Contacts
+ * without a message count are dropped when not seen for "contactExpiryDays"
+ * (0 keeps them).
+ */
+class IndexingPolicy
+{
+public:
+    IndexingPolicy();
+
+    void load(const KConfigGroup &cfg);
+
+    [[nodiscard]] IndexingTier tierForCollection(const Akonadi::Collection &collection) const;
+    [[nodiscard]] IndexingTier tierForDate(const QDateTime &dateTime, IndexingTier collectionTier) const;
+
+    void setCollectionTier(Akonadi::Collection::Id id, IndexingTier tier);
+    void setHeadersOnlyAfterDays(int days);
+    void setMetadataOnlyAfterDays(int days);
+
+    [[nodiscard]] qint64 maxIndexingTimePerItem() const;
+    void setMaxIndexingTimePerItem(qint64 msecs);
+    [[nodiscard]] qint64 maxDecodedBytesPerItem() const;
+    void setMaxDecodedBytesPerItem(qint64 bytes);
+    [[nodiscard]] int maxMimeDepth() const;
+    void setMaxMimeDepth(int depth);
+    [[nodiscard]] qint64 maxAttachmentBytes() const;
+    void setMaxAttachmentBytes(qint64 bytes);
+    [[nodiscard]] qint64 maxAttachmentBytesPerItem() const;
+    void setMaxAttachmentBytesPerItem(qint64 bytes);
+    [[nodiscard]] int attachmentWorkers() const;
+    void setAttachmentWorkers(int count);
+    [[nodiscard]] bool phraseBigrams() const;
+    void setPhraseBigrams(bool enabled);
+    [[nodiscard]] bool bodyPhraseBigrams() const;
+    void setBodyPhraseBigrams(bool enabled);
+    [[nodiscard]] bool substringTrigrams() const;
+    void setSubstringTrigrams(bool enabled);
+    [[nodiscard]] int contactExpiryDays() const;
+    void setContactExpiryDays(int days);
+
+    [[nodiscard]] static QByteArray tierToString(IndexingTier tier);
+    [[nodiscard]] static IndexingTier tierFromString(const QByteArray &str);
+
+private:
+    QSet<Akonadi::Collection::Id> m_headersOnlyCollections;
+    QSet<Akonadi::Collection::Id> m_metadataOnlyCollections;
+    int m_headersOnlyAfterDays = 0;
+    int m_metadataOnlyAfterDays = 0;
+    qint64 m_maxIndexingTimePerItem = 2000;
+    qint64 m_maxDecodedBytesPerItem = 8 * 1024 * 1024;
+    int m_maxMimeDepth = 16;
+    qint64 m_maxAttachmentBytes = 256 * 1024;
+    qint64 m_maxAttachmentBytesPerItem = 1024 * 1024;
+    int m_attachmentWorkers = 2;
+    bool m_phraseBigrams = true;
+    bool m_bodyPhraseBigrams = false;
+    bool m_substringTrigrams = false;
+    int m_contactExpiryDays = 0;
+};
@@ -0,0 +1,47 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include "indexingtierattribute.h"
+
+IndexingTierAttribute::IndexingTierAttribute(IndexingTier tier)
+    : m_tier(tier)
+{
+}
+
+IndexingTierAttribute::~IndexingTierAttribute() = default;
+
+IndexingTier IndexingTierAttribute::tier() const
+{
+    return m_tier;
+}
+
+void IndexingTierAttribute::setTier(IndexingTier tier)
+{
+    m_tier = tier;
+}
+
+QByteArray IndexingTierAttribute::type() const
+{
+    static const QByteArray sType("INDEXINGTIER");
+    return sType;
+}
+
+Akonadi::Attribute *IndexingTierAttribute::clone() const
+{
+    return new IndexingTierAttribute(m_tier);
+}
+
+QByteArray IndexingTierAttribute::serialized() const
+{
+    return IndexingPolicy::tierToString(m_tier);
+}
+
+void IndexingTierAttribute::deserialize(const QByteArray &data)
+{
+    m_tier = IndexingPolicy::tierFromString(data.trimmed());
+}
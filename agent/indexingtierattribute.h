@@ -0,0 +1,34 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include "indexingpolicy.h"
+
+#include <Akonadi/Attribute>
+
+/**
+ * Collection attribute overriding the configured indexing tier of a folder.
+ */
+class IndexingTierAttribute : public Akonadi::Attribute
+{
+public:
+    explicit IndexingTierAttribute(IndexingTier tier = IndexingTier::Full);
+    ~IndexingTierAttribute() override;
+
+    [[nodiscard]] IndexingTier tier() const;
+    void setTier(IndexingTier tier);
+
+    [[nodiscard]] QByteArray type() const override;
+    [[nodiscard]] Akonadi::Attribute *clone() const override;
+    [[nodiscard]] QByteArray serialized() const override;
+    void deserialize(const QByteArray &data) override;
+
+private:
+    IndexingTier m_tier;
+};
@@ -10,6 +10,7 @@
 
 #include <QApplication>
 #include <QDebug>
+#include <QDirIterator>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QTimer>
@@ -64,6 +65,13 @@ App::App(int &argc, char **argv, int flags)
 
 void App::main()
 {
+    // Compare the size and speed of the index with and without phrase bigrams
+    IndexingPolicy policy;
+    policy.setPhraseBigrams(!arguments().contains("--no-phrase-bigrams"_L1));
+    policy.setBodyPhraseBigrams(arguments().contains("--body-phrase-bigrams"_L1));
+    m_indexer.setIndexingPolicy(policy);
+    qDebug() << "Phrase bigrams:" << policy.phraseBigrams() << "Body phrase bigrams:" << policy.bodyPhraseBigrams();
+
     m_commitTimer.setInterval(1s);
     connect(&m_commitTimer, &QTimer::timeout, this, &App::slotCommitTimerElapsed);
     m_commitTimer.start();
@@ -188,6 +196,13 @@ void App::slotIndexed()
     }
     qDebug() << "\nThe actual read/writes may be 0 because of an existing"
              << "cache and /tmp being memory mapped";
+
+    qint64 dbSize = 0;
+    QDirIterator dbIt(u"/tmp/xap"_s, QDir::Files);
+    while (dbIt.hasNext()) {
+        dbSize += dbIt.nextFileInfo().size();
+    }
+    qDebug() << "Index Size:" << dbSize / 1024 << "kb";
     quit();
 }
 
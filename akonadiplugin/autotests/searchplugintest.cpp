@@ -12,9 +12,11 @@ using namespace Qt::Literals::StringLiterals;
 #include <KContacts/Addressee>
 #include <KContacts/ContactGroup>
 #include <QDir>
+#include <QStandardPaths>
 #include <QTest>
 
 #include "../agent/calendarindexer.h"
+#include "../agent/collectionindexer.h"
 #include "../agent/contactindexer.h"
 #include "../agent/emailindexer.h"
 #include "../search/calendar/calendarsearchstore.h"
@@ -59,6 +61,9 @@ private:
 private Q_SLOTS:
     void initTestCase()
     {
+        // Don't group the searched collections with the collection index of the user
+        QStandardPaths::setTestModeEnabled(true);
+
         emailDir = QDir::tempPath() + "/searchplugintest/email/"_L1;
         emailContactsDir = QDir::tempPath() + "/searchplugintest/emailcontacts/"_L1;
         contactsDir = QDir::tempPath() + "/searchplugintest/contacts/"_L1;
@@ -971,12 +976,137 @@ private Q_SLOTS:
             QSet<qint64> result = QSet<qint64>() << 4;
             QTest::newRow("search by from email part 2") << QString::fromLatin1(query.toJSON()) << allEmailCollections << emailMimeTypes << result;
         }
+        {
+            Akonadi::SearchQuery query;
+            query.addTerm(Akonadi::EmailSearchTerm(Akonadi::EmailSearchTerm::HeaderFrom, u"*@Test.com"_s, Akonadi::SearchTerm::CondContains));
+            QSet<qint64> result({1, 2, 3, 4, 5, 6});
+            QTest::newRow("search by from domain") << QString::fromLatin1(query.toJSON()) << allEmailCollections << emailMimeTypes << result;
+        }
+        {
+            Akonadi::SearchQuery query;
+            query.addTerm(Akonadi::EmailSearchTerm(Akonadi::EmailSearchTerm::HeaderFrom, u"john_blue@test.com"_s, Akonadi::SearchTerm::CondEqual));
+            QSet<qint64> result = QSet<qint64>() << 4;
+            QTest::newRow("search by from address") << QString::fromLatin1(query.toJSON()) << allEmailCollections << emailMimeTypes << result;
+        }
     }
 
     void testEmailSearch()
     {
         resultSearch();
     }
+
+    void testPagedSearch()
+    {
+        const QString query = QString::fromLatin1(Akonadi::SearchQuery().toJSON());
+        const QList<qint64> collections({1, 2});
+        const QStringList mimeTypes({u"message/rfc822"_s});
+
+        SearchPlugin plugin;
+        const QSet<qint64> expected = plugin.search(query, collections, mimeTypes);
+        QVERIFY(expected.size() > 2);
+
+        QSet<qint64> result;
+        int pages = 0;
+        qsizetype largestPage = 0;
+        plugin.search(query, collections, mimeTypes, 2, [&](const QList<qint64> &ids) {
+            ++pages;
+            largestPage = std::max(largestPage, ids.size());
+            for (const qint64 id : ids) {
+                result.insert(id);
+            }
+            return true;
+        });
+        QCOMPARE(result, expected);
+        QCOMPARE(largestPage, 2);
+        QCOMPARE(pages, (expected.size() + 1) / 2);
+
+        // The handler stops the search
+        pages = 0;
+        plugin.search(query, collections, mimeTypes, 2, [&pages](const QList<qint64> &) {
+            ++pages;
+            return false;
+        });
+        QCOMPARE(pages, 1);
+    }
+
+    void testSubtreeSearch()
+    {
+        // An account with an inbox and an archive, which has a subfolder
+        Akonadi::Collection account(20);
+        Akonadi::Collection inbox(21);
+        inbox.setParentCollection(account);
+        Akonadi::Collection archive(22);
+        archive.setParentCollection(account);
+        Akonadi::Collection archive2025(23);
+        archive2025.setParentCollection(archive);
+
+        const QString collectionsDir = QDir::tempPath() + "/searchplugintest/collections/"_L1;
+        {
+            CollectionIndexer collectionIndexer(collectionsDir);
+            for (const Akonadi::Collection &col : {account, inbox, archive, archive2025}) {
+                collectionIndexer.index(col);
+            }
+            collectionIndexer.commit();
+        }
+        {
+            EmailIndexer emailIndexer(emailDir, emailContactsDir);
+            Akonadi::Item::Id id = 3001;
+            for (const Akonadi::Collection &col : {inbox, archive, archive2025}) {
+                auto msg = std::make_shared<KMime::Message>();
+                msg->subject()->from7BitString("subtree");
+                msg->assemble();
+
+                Akonadi::Item item(KMime::Message::mimeType());
+                item.setId(id++);
+                item.setPayload(msg);
+                item.setParentCollection(col);
+                emailIndexer.index(item);
+            }
+            emailIndexer.commit();
+        }
+
+        const QString query = QString::fromLatin1(Akonadi::SearchQuery().toJSON());
+        const QStringList mimeTypes({u"message/rfc822"_s});
+        SearchPlugin plugin;
+        plugin.setCollectionDatabaseDir(collectionsDir);
+
+        // Whole subtrees
+        QCOMPARE(plugin.search(query, {22, 23}, mimeTypes), QSet<qint64>({3002, 3003}));
+        QCOMPARE(plugin.search(query, {20, 21, 22, 23}, mimeTypes), QSet<qint64>({3001, 3002, 3003}));
+        // Not all the subfolders
+        QCOMPARE(plugin.search(query, {22}, mimeTypes), QSet<qint64>({3002}));
+        QCOMPARE(plugin.search(query, {20, 21, 22}, mimeTypes), QSet<qint64>({3001, 3002}));
+        // Collections unknown to the collection index
+        QCOMPARE(plugin.search(query, {21, 1}, mimeTypes), plugin.search(query, {21}, mimeTypes) + plugin.search(query, {1}, mimeTypes));
+
+        // A subfolder the collection index doesn't know yet
+        Akonadi::Collection archive2026(24);
+        archive2026.setParentCollection(archive);
+        {
+            EmailIndexer emailIndexer(emailDir, emailContactsDir);
+            auto msg = std::make_shared<KMime::Message>();
+            msg->subject()->from7BitString("subtree");
+            msg->assemble();
+
+            Akonadi::Item item(KMime::Message::mimeType());
+            item.setId(3004);
+            item.setPayload(msg);
+            item.setParentCollection(archive2026);
+            emailIndexer.index(item);
+            emailIndexer.commit();
+        }
+        QCOMPARE(plugin.search(query, {22, 23}, mimeTypes), QSet<qint64>({3002, 3003}));
+        QCOMPARE(plugin.search(query, {20, 21, 22, 23}, mimeTypes), QSet<qint64>({3001, 3002, 3003}));
+
+        // Once it knows it
+        {
+            CollectionIndexer collectionIndexer(collectionsDir);
+            collectionIndexer.index(archive2026);
+            collectionIndexer.commit();
+        }
+        QCOMPARE(plugin.search(query, {22, 23}, mimeTypes), QSet<qint64>({3002, 3003}));
+        QCOMPARE(plugin.search(query, {22, 23, 24}, mimeTypes), QSet<qint64>({3002, 3003, 3004}));
+    }
 };
 
 QTEST_GUILESS_MAIN(SearchPluginTest)
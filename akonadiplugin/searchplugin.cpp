@@ -8,7 +8,9 @@
 
 #include "searchplugin.h"
 
+#include "lib/collectionquery.h"
 #include "query.h"
+#include "search/email/addressterms.h"
 #include "resultiterator.h"
 #include "term.h"
 
@@ -16,9 +18,12 @@
 
 #include "akonadiplugin_indexer_debug.h"
 #include <Akonadi/MessageFlags>
+#include <Akonadi/Tag>
 #include <KContacts/Addressee>
 #include <KContacts/ContactGroup>
 
+#include <algorithm>
+
 using namespace Qt::Literals::StringLiterals;
 using namespace Akonadi::Search;
 
@@ -60,6 +65,24 @@ static Term getTerm(const Akonadi::SearchTerm &term, const QString &property)
     return t;
 }
 
+// Domains ("@example.org" or "*@example.org") and complete addresses
+// are looked up with the structured address terms of the field
+static Term getAddressTerm(const Akonadi::SearchTerm &term, const QString &property)
+{
+    const AddressFilter filter = AddressFilter::parse(term.value().toString());
+    // Only an equality matches a complete address exactly
+    if (!filter.isValid() || (!filter.isDomain() && term.condition() != Akonadi::SearchTerm::CondEqual)) {
+        return getTerm(term, property);
+    }
+
+    Term t(Term::Or);
+    t.setNegation(term.isNegated());
+    for (const AddressTermKind kind : filter.kinds) {
+        t.addSubTerm(Term(property + addressPropertySuffix(kind), filter.value, Term::Equal));
+    }
+    return t;
+}
+
 static Term recursiveEmailTermMapping(const Akonadi::SearchTerm &term)
 {
     const auto subTermsResult = term.subTerms();
@@ -102,13 +125,13 @@ static Term recursiveEmailTermMapping(const Akonadi::SearchTerm &term)
         case Akonadi::EmailSearchTerm::Subject:
             return getTerm(term, u"subject"_s);
         case Akonadi::EmailSearchTerm::HeaderFrom:
-            return getTerm(term, u"from"_s);
+            return getAddressTerm(term, u"from"_s);
         case Akonadi::EmailSearchTerm::HeaderTo:
-            return getTerm(term, u"to"_s);
+            return getAddressTerm(term, u"to"_s);
         case Akonadi::EmailSearchTerm::HeaderCC:
-            return getTerm(term, u"cc"_s);
+            return getAddressTerm(term, u"cc"_s);
         case Akonadi::EmailSearchTerm::HeaderBCC:
-            return getTerm(term, u"bcc"_s);
+            return getAddressTerm(term, u"bcc"_s);
         case Akonadi::EmailSearchTerm::MessageStatus: {
             const QString value = term.value().toString();
             if (value == QLatin1StringView(Akonadi::MessageFlags::Flagged)) {
@@ -158,11 +181,23 @@ static Term recursiveEmailTermMapping(const Akonadi::SearchTerm &term)
             }
             break;
         }
-        case Akonadi::EmailSearchTerm::MessageTag:
-            // search directly in akonadi? or index tags.
-            break;
+        case Akonadi::EmailSearchTerm::MessageTag: {
+            // Tags are indexed by id, but may be given as akonadi:?tag=<id> url
+            const QString value = term.value().toString();
+            bool ok = false;
+            Akonadi::Tag::Id id = value.toLongLong(&ok);
+            if (!ok) {
+                id = Akonadi::Tag::fromUrl(QUrl(value)).id();
+            }
+            if (id < 0) {
+                break;
+            }
+            Term t(u"tag"_s, QString::number(id), Term::Equal);
+            t.setNegation(term.isNegated());
+            return t;
+        }
         case Akonadi::EmailSearchTerm::HeaderReplyTo:
-            return getTerm(term, u"replyto"_s);
+            return getAddressTerm(term, u"replyto"_s);
         case Akonadi::EmailSearchTerm::HeaderOrganization:
             return getTerm(term, u"organization"_s);
         case Akonadi::EmailSearchTerm::HeaderListId:
@@ -286,24 +321,27 @@ static Term recursiveContactTermMapping(const Akonadi::SearchTerm &term)
     return {};
 }
 
-QSet<qint64> SearchPlugin::search(const QString &akonadiQuery, const QList<qint64> &collections, const QStringList &mimeTypes)
+static bool buildQuery(const QString &akonadiQuery,
+                       const QList<qint64> &collections,
+                       const QStringList &mimeTypes,
+                       const Akonadi::Search::PIM::CollectionQuery &collectionQuery,
+                       Query &query)
 {
     if (akonadiQuery.isEmpty() && collections.isEmpty() && mimeTypes.isEmpty()) {
         qCWarning(AKONADIPLUGIN_INDEXER_LOG) << "empty query";
-        return {};
+        return false;
     }
 
     Akonadi::SearchQuery searchQuery;
     if (!akonadiQuery.isEmpty()) {
         searchQuery = Akonadi::SearchQuery::fromJSON(akonadiQuery.toLatin1());
         if (searchQuery.isNull() && collections.isEmpty() && mimeTypes.isEmpty()) {
-            return {};
+            return false;
         }
     }
 
     const Akonadi::SearchTerm term = searchQuery.term();
 
-    Query query;
     Term t;
 
     if (mimeTypes.contains("message/rfc822"_L1)) {
@@ -322,18 +360,32 @@ QSet<qint64> SearchPlugin::search(const QString &akonadiQuery, const QList<qint6
         t = recursiveCalendarTermMapping(term);
     } else {
         // Unknown type
-        return {};
+        return false;
     }
 
     if (searchQuery.limit() > 0) {
         query.setLimit(searchQuery.limit());
+    } else {
+        // All the matches are wanted. Matching in index order, each page of
+        // execPaged() stops once it has its results instead of ranking them all.
+        query.setSortingOption(Query::SortNone);
     }
 
     // Filter by collection if not empty
     if (!collections.isEmpty()) {
         Term parentTerm(Term::And);
         Term collectionTerm(Term::Or);
-        for (const qint64 col : collections) {
+        // Recursive searches list every subfolder, match each whole subtree with a single term.
+        // The store checks its items against the listed collections before using it.
+        const Akonadi::Search::PIM::CollectionQuery::Subtrees subtrees = collectionQuery.subtrees(collections);
+        for (const qint64 col : subtrees.roots) {
+            QStringList subtree{QString::number(col)};
+            for (const qint64 member : subtrees.members.value(col)) {
+                subtree << QString::number(member);
+            }
+            collectionTerm.addSubTerm(Term(u"subtree"_s, subtree, Term::Equal));
+        }
+        for (const qint64 col : subtrees.collections) {
             collectionTerm.addSubTerm(Term(u"collection"_s, QString::number(col), Term::Equal));
         }
         if (t.isEmpty()) {
@@ -346,22 +398,62 @@ QSet<qint64> SearchPlugin::search(const QString &akonadiQuery, const QList<qint6
     } else {
         if (t.subTerms().isEmpty()) {
             qCWarning(AKONADIPLUGIN_INDEXER_LOG) << "no terms added";
-            return {};
+            return false;
         }
 
         query.setTerm(t);
     }
 
+    return true;
+}
+
+SearchPlugin::SearchPlugin()
+    : m_collectionQuery(std::make_unique<Akonadi::Search::PIM::CollectionQuery>())
+{
+}
+
+SearchPlugin::~SearchPlugin() = default;
+
+QSet<qint64> SearchPlugin::search(const QString &akonadiQuery, const QList<qint64> &collections, const QStringList &mimeTypes)
+{
     QSet<qint64> resultSet;
-    // qCDebug(AKONADIPLUGIN_INDEXER_LOG) << query.toJSON();
-    ResultIterator iter = query.exec();
-    while (iter.next()) {
-        const QByteArray id = iter.id();
-        const int fid = deserialize("akonadi", id);
-        resultSet << fid;
-    }
+    search(akonadiQuery, collections, mimeTypes, m_pageSize, [&resultSet](const QList<qint64> &ids) {
+        for (const qint64 id : ids) {
+            resultSet.insert(id);
+        }
+        return true;
+    });
     qCDebug(AKONADIPLUGIN_INDEXER_LOG) << "Got" << resultSet.count() << "results";
     return resultSet;
 }
 
+void SearchPlugin::search(const QString &akonadiQuery,
+                          const QList<qint64> &collections,
+                          const QStringList &mimeTypes,
+                          uint pageSize,
+                          const std::function<bool(const QList<qint64> &ids)> &handlePage)
+{
+    Query query;
+    if (!buildQuery(akonadiQuery, collections, mimeTypes, *m_collectionQuery, query)) {
+        return;
+    }
+    // qCDebug(AKONADIPLUGIN_INDEXER_LOG) << query.toJSON();
+    query.execPaged(pageSize, handlePage);
+}
+
+uint SearchPlugin::pageSize() const
+{
+    return m_pageSize;
+}
+
+void SearchPlugin::setPageSize(uint pageSize)
+{
+    m_pageSize = std::max(pageSize, 1U);
+}
+
+void SearchPlugin::setCollectionDatabaseDir(const QString &dir)
+{
+    m_collectionQuery->setDatabaseDir(dir);
+}
+
 #include "moc_searchplugin.cpp"
@@ -14,11 +14,18 @@ using namespace Qt::Literals::StringLiterals;
 #include <QStringList>
 #include <akonadi/abstractsearchplugin.h>
 
+#include <functional>
+#include <memory>
+
 namespace Akonadi
 {
 namespace Search
 {
 class Query;
+namespace PIM
+{
+class CollectionQuery;
+}
 }
 }
 
@@ -28,5 +35,38 @@ class SearchPlugin : public QObject, public Akonadi::AbstractSearchPlugin
     Q_INTERFACES(Akonadi::AbstractSearchPlugin)
     Q_PLUGIN_METADATA(IID "org.kde.akonadi.SearchPlugin" FILE "akonadi_search_plugin.json")
 public:
+    SearchPlugin();
+    ~SearchPlugin() override;
+
+    /**
+     * Collects the results of all the pages of pageSize() results.
+     *
+     * Only the search is paged, the returned set holds every result. Use the
+     * overload taking a page handler to keep memory bounded.
+     */
     [[nodiscard]] QSet<qint64> search(const QString &query, const QList<qint64> &collections, const QStringList &mimeTypes) override;
+
+    /**
+     * Passes the item ids matching @p query to @p handlePage, at most
+     * @p pageSize at a time, so search collections can be filled up
+     * incrementally. Returning false from @p handlePage stops the search.
+     */
+    void search(const QString &query,
+                const QList<qint64> &collections,
+                const QStringList &mimeTypes,
+                uint pageSize,
+                const std::function<bool(const QList<qint64> &ids)> &handlePage);
+
+    [[nodiscard]] uint pageSize() const;
+    void setPageSize(uint pageSize);
+
+    /**
+     * For testing, the collection index giving the subtrees of the searched collections
+     */
+    void setCollectionDatabaseDir(const QString &dir);
+
+private:
+    uint m_pageSize = 10000;
+    // Keeps the collection index open across searches
+    const std::unique_ptr<Akonadi::Search::PIM::CollectionQuery> m_collectionQuery;
 };
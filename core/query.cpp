@@ -20,6 +20,8 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 
+#include <algorithm>
+
 using namespace Qt::Literals::StringLiterals;
 using namespace Akonadi::Search;
 
@@ -34,6 +36,7 @@ public:
     QString m_searchString;
     uint m_limit = defaultLimit;
     uint m_offset = 0;
+    uint m_pageSize = 0;
 
     int m_yearFilter = -1;
     int m_monthFilter = -1;
@@ -130,6 +133,16 @@ void Query::setOffset(uint offset)
     d->m_offset = offset;
 }
 
+uint Query::pageSize() const
+{
+    return d->m_pageSize;
+}
+
+void Query::setPageSize(uint pageSize)
+{
+    d->m_pageSize = pageSize;
+}
+
 void Query::setDateFilter(int year, int month, int day)
 {
     d->m_yearFilter = year;
@@ -228,6 +241,33 @@ ResultIterator Query::exec()
     return {id, storeMatch};
 }
 
+void Query::execPaged(uint pageSize, const std::function<bool(const QList<qint64> &ids)> &handlePage)
+{
+    Q_ASSERT_X(pageSize > 0, "Akonadi::Search::Query::execPaged", "The page size must not be 0");
+    if (pageSize == 0) {
+        return;
+    }
+
+    // A single search, the store fetches one page of it at a time from the same revision of the index
+    Query query(*this);
+    query.setPageSize(pageSize);
+    ResultIterator it = query.exec();
+    QList<qint64> ids;
+    ids.reserve(std::min(pageSize, d->m_limit));
+    while (it.next()) {
+        ids.append(it.numericId());
+        if (static_cast<uint>(ids.size()) == pageSize) {
+            if (!handlePage(ids)) {
+                return;
+            }
+            ids.clear();
+        }
+    }
+    if (!ids.isEmpty()) {
+        handlePage(ids);
+    }
+}
+
 QByteArray Query::toJSON() const
 {
     QVariantMap map;
@@ -244,6 +284,10 @@ QByteArray Query::toJSON() const
         map[u"offset"_s] = d->m_offset;
     }
 
+    if (d->m_pageSize) {
+        map[u"pageSize"_s] = d->m_pageSize;
+    }
+
     if (!d->m_searchString.isEmpty()) {
         map[u"searchString"_s] = d->m_searchString;
     }
@@ -295,6 +339,7 @@ Query Query::fromJSON(const QByteArray &arr)
     }
 
     query.d->m_offset = map[u"offset"_s].toUInt();
+    query.d->m_pageSize = map[u"pageSize"_s].toUInt();
     query.d->m_searchString = map[u"searchString"_s].toString();
     query.d->m_term = Term::fromVariantMap(map[u"term"_s].toMap());
 
@@ -11,6 +11,9 @@
 #include "resultiterator.h"
 #include "search_core_export.h"
 
+#include <QList>
+
+#include <functional>
 #include <memory>
 
 class QVariant;
@@ -153,11 +156,32 @@ public:
      */
     [[nodiscard]] uint offset() const;
 
+    /*!
+     * \brief Sets how many results the search store fetches from the index at a time.
+     *
+     * The results of a query are read from a single revision of the index,
+     * \a pageSize of them at a time, so only one page of them is held in
+     * memory. This costs one match per page, it is meant for unsorted
+     * queries, see SortNone. By default, 0, all the results are fetched at once.
+     * \param pageSize The number of results per fetch.
+     * \sa pageSize(), execPaged()
+     */
+    void setPageSize(uint pageSize);
+    /*!
+     * \brief Returns how many results the search store fetches at a time.
+     * \return The page size, 0 for all at once.
+     * \sa setPageSize()
+     */
+    [[nodiscard]] uint pageSize() const;
+
     /*!
      * \brief Filters the results in the specified date range.
      * \param year The year to filter by, or -1 to ignore.
      * \param month The month to filter by, or -1 to ignore. Default is -1.
      * \param day The day to filter by, or -1 to ignore. Default is -1.
+     *
+     * The email and calendar stores match the date of messages and the start
+     * date of events.
      * \sa yearFilter(), monthFilter(), dayFilter()
      */
     void setDateFilter(int year, int month = -1, int day = -1);
@@ -223,6 +247,12 @@ public:
      * \brief Sets the property to use for sorting query results.
      * \param property The property name to sort by.
      *
+     * Several properties can be given separated by commas, such as
+     * "date,size", the later ones breaking ties. A leading '-' sorts
+     * a property in descending order, "-date" returns the newest first.
+     * Only properties stored as values, such as the email "date" and
+     * "size", can be sorted on.
+     *
      * This automatically sets the sorting mechanism to SortProperty.
      * \sa sortingProperty(), setSortingOption()
      */
@@ -272,6 +302,21 @@ public:
      */
     [[nodiscard]] ResultIterator exec();
 
+    /*!
+     * \brief Executes the query one page of at most \a pageSize results at a time.
+     *
+     * \a handlePage is called with the numeric IDs of each page, in order,
+     * and stops the search by returning \c false. Like exec(), at most
+     * limit() results are returned, starting at offset().
+     *
+     * The search store fetches the results \a pageSize at a time, see
+     * setPageSize(), so only one page of results is held in memory. All the
+     * pages are read from the revision of the index the query started at,
+     * even when it changes meanwhile.
+     * \sa exec(), ResultIterator::numericId()
+     */
+    void execPaged(uint pageSize, const std::function<bool(const QList<qint64> &ids)> &handlePage);
+
     /*!
      * \brief Converts the query to JSON representation.
      * \return A JSON representation of the query.
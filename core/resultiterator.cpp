@@ -46,6 +46,15 @@ QByteArray ResultIterator::id() const
     }
 }
 
+qint64 ResultIterator::numericId() const
+{
+    if (d->store) {
+        return d->store->numericId(d->queryId);
+    } else {
+        return 0;
+    }
+}
+
 QUrl ResultIterator::url() const
 {
     if (d->store) {
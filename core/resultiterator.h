@@ -66,6 +66,11 @@ public:
     /*!
      */
     [[nodiscard]] QByteArray id() const;
+    /*!
+     * \brief Returns the ID of the current result as a number, or 0 if there is none.
+     * \sa id()
+     */
+    [[nodiscard]] qint64 numericId() const;
     /*!
      */
     [[nodiscard]] QUrl url() const;
@@ -27,6 +27,12 @@ SearchStore::SearchStore(QObject *parent)
 
 SearchStore::~SearchStore() = default;
 
+qint64 SearchStore::numericId(int queryId)
+{
+    const QByteArray str = id(queryId);
+    return str.mid(str.indexOf(':') + 1).toLongLong();
+}
+
 QUrl SearchStore::url(int)
 {
     return {};
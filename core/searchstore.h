@@ -103,6 +103,17 @@ public:
      */
     [[nodiscard]] virtual QByteArray id(int queryId) = 0;
 
+    /*!
+     * \brief Returns the ID of the current result as a number.
+     *
+     * The default implementation parses id(). Stores knowing the number
+     * should return it without serializing it first.
+     * \param queryId The query ID returned by exec().
+     * \return The numeric ID of the current result, or 0 if there is none.
+     * \sa id()
+     */
+    [[nodiscard]] virtual qint64 numericId(int queryId);
+
     /*!
      * \brief Returns the URL of the current result.
      * \param queryId The query ID returned by exec().
@@ -7,6 +7,7 @@
 #include "akonadisearchdebugwidget.h"
 
 #include "akonadisearchsyntaxhighlighter.h"
+#include "job/akonadisearchdebugquarantinejob.h"
 #include "job/akonadisearchdebugsearchjob.h"
 #include <KLineEditEventHandler>
 #include <QLineEdit>
@@ -26,6 +27,7 @@ AkonadiSearchDebugWidget::AkonadiSearchDebugWidget(QWidget *parent)
     , mSearchPathComboBox(new Akonadi::Search::AkonadiSearchDebugSearchPathComboBox(this))
     , mLineEdit(new QLineEdit(this))
     , mSearchButton(new QPushButton(u"Search"_s, this))
+    , mQuarantineButton(new QPushButton(u"Quarantine"_s, this))
 {
     auto mainLayout = new QVBoxLayout(this);
 
@@ -47,6 +49,11 @@ AkonadiSearchDebugWidget::AkonadiSearchDebugWidget(QWidget *parent)
     hbox->addWidget(mSearchButton);
     mSearchButton->setEnabled(false);
 
+    mQuarantineButton->setObjectName("quarantinebutton"_L1);
+    mQuarantineButton->setToolTip(u"Show items which were too expensive to index fully"_s);
+    connect(mQuarantineButton, &QPushButton::clicked, this, &AkonadiSearchDebugWidget::showQuarantine);
+    hbox->addWidget(mQuarantineButton);
+
     new AkonadiSearchSyntaxHighlighter(mPlainTextEditor->document());
     mPlainTextEditor->setReadOnly(true);
     mainLayout->addWidget(mPlainTextEditor);
@@ -96,6 +103,14 @@ void AkonadiSearchDebugWidget::slotSearch()
     job->start();
 }
 
+void AkonadiSearchDebugWidget::showQuarantine()
+{
+    auto job = new Akonadi::Search::AkonadiSearchDebugQuarantineJob(this);
+    connect(job, &Akonadi::Search::AkonadiSearchDebugQuarantineJob::result, this, &AkonadiSearchDebugWidget::slotResult);
+    connect(job, &Akonadi::Search::AkonadiSearchDebugQuarantineJob::error, this, &AkonadiSearchDebugWidget::slotError);
+    job->start();
+}
+
 void AkonadiSearchDebugWidget::slotResult(const QString &result)
 {
     mPlainTextEditor->setPlainText(result);
@@ -40,6 +40,9 @@ public:
     /*!
      */
     void doSearch();
+    /*!
+     */
+    void showQuarantine();
 
     /*!
      */
@@ -54,6 +57,7 @@ private:
     AkonadiSearchDebugSearchPathComboBox *const mSearchPathComboBox;
     QLineEdit *const mLineEdit;
     QPushButton *const mSearchButton;
+    QPushButton *const mQuarantineButton;
 };
 }
 }
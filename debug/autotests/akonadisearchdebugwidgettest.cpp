@@ -37,6 +37,9 @@ void AkonadiSearchDebugWidgetTest::shouldHaveDefaultValue()
     QVERIFY(editorWidget->toPlainText().isEmpty());
     auto searchCombo = widget.findChild<Akonadi::Search::AkonadiSearchDebugSearchPathComboBox *>(u"searchpathcombo"_s);
     QVERIFY(searchCombo);
+    auto quarantineButton = widget.findChild<QPushButton *>(u"quarantinebutton"_s);
+    QVERIFY(quarantineButton);
+    QVERIFY(quarantineButton->isEnabled());
 }
 
 void AkonadiSearchDebugWidgetTest::shouldFillLineEditWhenWeWantToSearchItem()
@@ -0,0 +1,88 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "akonadisearchdebugquarantinejob.h"
+using namespace Qt::Literals::StringLiterals;
+
+#include <Akonadi/ServerManager>
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+
+using namespace Akonadi::Search;
+
+namespace
+{
+QDBusMessage indexerCall(const QString &service, const QString &method)
+{
+    return QDBusMessage::createMethodCall(service, u"/"_s, u"org.freedesktop.Akonadi.Indexer"_s, method);
+}
+}
+
+AkonadiSearchDebugQuarantineJob::AkonadiSearchDebugQuarantineJob(QObject *parent)
+    : QObject(parent)
+    , mService(Akonadi::ServerManager::agentServiceName(Akonadi::ServerManager::Agent, u"akonadi_indexing_agent"_s))
+{
+}
+
+AkonadiSearchDebugQuarantineJob::~AkonadiSearchDebugQuarantineJob() = default;
+
+void AkonadiSearchDebugQuarantineJob::start()
+{
+    const QDBusPendingCall call = QDBusConnection::sessionBus().asyncCall(indexerCall(mService, u"quarantinedItems"_s));
+    auto watcher = new QDBusPendingCallWatcher(call, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &AkonadiSearchDebugQuarantineJob::slotItemsReceived);
+}
+
+void AkonadiSearchDebugQuarantineJob::slotItemsReceived(QDBusPendingCallWatcher *watcher)
+{
+    const QDBusPendingReply<QList<qlonglong>> reply = *watcher;
+    watcher->deleteLater();
+    if (reply.isError()) {
+        // Don't translate it. Just debug
+        Q_EMIT error(u"Unable to ask the indexing agent: %1"_s.arg(reply.error().message()));
+        deleteLater();
+        return;
+    }
+
+    const QList<qlonglong> ids = reply.value();
+    if (ids.isEmpty()) {
+        emitResult();
+        return;
+    }
+    mPendingReasons = ids.count();
+    for (const qlonglong id : ids) {
+        QDBusMessage msg = indexerCall(mService, u"quarantineReason"_s);
+        msg << id;
+        auto reasonWatcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(msg), this);
+        reasonWatcher->setProperty("itemId", id);
+        connect(reasonWatcher, &QDBusPendingCallWatcher::finished, this, &AkonadiSearchDebugQuarantineJob::slotReasonReceived);
+    }
+}
+
+void AkonadiSearchDebugQuarantineJob::slotReasonReceived(QDBusPendingCallWatcher *watcher)
+{
+    const QDBusPendingReply<QString> reply = *watcher;
+    mReasons.insert(watcher->property("itemId").toLongLong(), reply.isError() ? reply.error().message() : reply.value());
+    watcher->deleteLater();
+    if (--mPendingReasons == 0) {
+        emitResult();
+    }
+}
+
+void AkonadiSearchDebugQuarantineJob::emitResult()
+{
+    QString text = u"Quarantined items: %1\n"_s.arg(mReasons.count());
+    for (auto it = mReasons.cbegin(), end = mReasons.cend(); it != end; ++it) {
+        text += u"%1: %2\n"_s.arg(it.key()).arg(it.value());
+    }
+    Q_EMIT result(text);
+    deleteLater();
+}
+
+#include "moc_akonadisearchdebugquarantinejob.cpp"
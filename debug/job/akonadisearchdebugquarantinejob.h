@@ -0,0 +1,42 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QMap>
+#include <QObject>
+class QDBusPendingCallWatcher;
+namespace Akonadi
+{
+namespace Search
+{
+/**
+ * Asks the indexing agent over D-Bus which items exceeded their indexing
+ * budget and were indexed headers-only.
+ */
+class AkonadiSearchDebugQuarantineJob : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AkonadiSearchDebugQuarantineJob(QObject *parent = nullptr);
+    ~AkonadiSearchDebugQuarantineJob() override;
+
+    void start();
+
+Q_SIGNALS:
+    void error(const QString &errorString);
+    void result(const QString &text);
+
+private:
+    void slotItemsReceived(QDBusPendingCallWatcher *watcher);
+    void slotReasonReceived(QDBusPendingCallWatcher *watcher);
+    void emitResult();
+    QMap<qlonglong, QString> mReasons;
+    QString mService;
+    int mPendingReasons = 0;
+};
+}
+}
@@ -12,9 +12,14 @@
 #include "collectionquery.h"
 #include "resultiterator_p.h"
 #include <QFile>
+#include <QHash>
 #include <QList>
+#include <QMutex>
+#include <QSet>
 
 #include <QStandardPaths>
+
+#include <optional>
 using namespace Qt::Literals::StringLiterals;
 using namespace Akonadi::Search::PIM;
 
@@ -28,6 +33,10 @@ public:
     QString pathString;
     QString databaseDir;
     int limit;
+
+    // Kept open by subtrees(), the handle isn't thread safe
+    QMutex dbMutex;
+    std::optional<Xapian::Database> db;
 };
 
 CollectionQuery::CollectionQuery()
@@ -41,7 +50,9 @@ CollectionQuery::~CollectionQuery() = default;
 
 void CollectionQuery::setDatabaseDir(const QString &dir)
 {
+    QMutexLocker locker(&d->dbMutex);
     d->databaseDir = dir;
+    d->db.reset();
 }
 
 void CollectionQuery::nameMatches(const QString &match)
@@ -146,3 +157,100 @@ ResultIterator CollectionQuery::exec()
     iter.d->init(mset);
     return iter;
 }
+
+CollectionQuery::Subtrees CollectionQuery::subtrees(const QList<Akonadi::Collection::Id> &collections) const
+{
+    Subtrees result;
+    QMutexLocker locker(&d->dbMutex);
+    try {
+        if (d->db) {
+            d->db->reopen();
+        } else {
+            d->db = Xapian::Database(QFile::encodeName(d->databaseDir).toStdString());
+        }
+    } catch (const Xapian::DatabaseError &e) {
+        qCWarning(AKONADI_SEARCH_PIM_LOG) << "Failed to open Xapian database:" << d->databaseDir << "; error:" << QString::fromStdString(e.get_error_string());
+        d->db.reset();
+        result.collections = collections;
+        return result;
+    }
+    const Xapian::Database &db = *d->db;
+
+    const QSet<Akonadi::Collection::Id> listed(collections.cbegin(), collections.cend());
+    try {
+        // The listed collections with subfolders, all of them listed too
+        QSet<Akonadi::Collection::Id> complete;
+        for (const Akonadi::Collection::Id id : listed) {
+            const std::string term = "XCA:" + std::to_string(id);
+            bool hasSubfolders = false;
+            bool allListed = true;
+            for (auto it = db.postlist_begin(term), end = db.postlist_end(term); it != end && allListed; ++it) {
+                const Akonadi::Collection::Id descendant = *it;
+                if (descendant != id) {
+                    hasSubfolders = true;
+                    allListed = listed.contains(descendant);
+                }
+            }
+            if (hasSubfolders && allListed) {
+                complete.insert(id);
+            }
+        }
+
+        QSet<Akonadi::Collection::Id> seen;
+        QHash<Akonadi::Collection::Id, QList<Akonadi::Collection::Id>> coveringRoots;
+        for (const Akonadi::Collection::Id id : collections) {
+            if (seen.contains(id)) {
+                continue;
+            }
+            seen.insert(id);
+
+            // Skip the collections below a root, its subtree term covers them
+            QList<Akonadi::Collection::Id> ancestors;
+            try {
+                const Xapian::Document doc = db.get_document(id);
+                Xapian::TermIterator it = doc.termlist_begin();
+                it.skip_to("XCA:");
+                for (; it != doc.termlist_end(); ++it) {
+                    const std::string term = *it;
+                    if (term.compare(0, 4, "XCA:") != 0) {
+                        break;
+                    }
+                    const Akonadi::Collection::Id ancestor = std::stoll(term.substr(4));
+                    if (ancestor != id && complete.contains(ancestor)) {
+                        ancestors << ancestor;
+                    }
+                }
+            } catch (const Xapian::DocNotFoundError &) {
+            }
+            if (!ancestors.isEmpty()) {
+                coveringRoots.insert(id, ancestors);
+                continue;
+            }
+            if (complete.contains(id)) {
+                result.roots << id;
+            } else {
+                result.collections << id;
+            }
+        }
+
+        for (const Akonadi::Collection::Id id : collections) {
+            const auto ancestors = coveringRoots.constFind(id);
+            if (ancestors == coveringRoots.cend()) {
+                continue;
+            }
+            for (const Akonadi::Collection::Id ancestor : *ancestors) {
+                if (result.roots.contains(ancestor)) {
+                    auto &members = result.members[ancestor];
+                    if (!members.contains(id)) {
+                        members << id;
+                    }
+                }
+            }
+        }
+    } catch (const Xapian::Error &e) {
+        qCWarning(AKONADI_SEARCH_PIM_LOG) << "Failed to read the collection hierarchy:" << QString::fromStdString(e.get_error_string());
+        result = Subtrees();
+        result.collections = collections;
+    }
+    return result;
+}
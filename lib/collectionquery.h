@@ -13,6 +13,7 @@
 #include "search_pim_export.h"
 
 #include <Akonadi/Collection>
+#include <QHash>
 #include <QStringList>
 
 #include <memory>
@@ -93,6 +94,36 @@ public:
      */
     [[nodiscard]] ResultIterator exec() override;
 
+    /*!
+     * \brief A list of collections, grouped by the subtrees they cover.
+     */
+    struct Subtrees {
+        /*! The collections whose subfolders were all listed, each matched by a single subtree term. */
+        QList<Akonadi::Collection::Id> roots;
+        /*! The other listed collections, not below any of the roots. */
+        QList<Akonadi::Collection::Id> collections;
+        /*! The listed collections below each root, to search instead of its subtree term. */
+        QHash<Akonadi::Collection::Id, QList<Akonadi::Collection::Id>> members;
+    };
+
+    /*!
+     * \brief Groups \a collections by the subtrees they cover.
+     *
+     * Searching a folder and all its subfolders only needs the "subtree" term
+     * of the folder instead of one term per collection. The hierarchy comes
+     * from the collection index, collections unknown to it are left as they are.
+     *
+     * The item index may already know subfolders the collection index doesn't,
+     * so a root only stands for its subtree once the items below it are all in
+     * the root or its listed members. Otherwise the collections have to be
+     * searched one by one.
+     *
+     * The collection database stays open between calls.
+     * \param collections The collection IDs to group.
+     * \return The subtree roots and the remaining collections.
+     */
+    [[nodiscard]] Subtrees subtrees(const QList<Akonadi::Collection::Id> &collections) const;
+
     /*!
      * For testing
      */
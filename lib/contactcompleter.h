@@ -9,6 +9,7 @@
 #pragma once
 
 #include "search_pim_export.h"
+#include <QFuture>
 #include <QString>
 
 namespace Akonadi
@@ -17,7 +18,6 @@ namespace Search
 {
 namespace PIM
 {
-// FIXME: Make this async!!
 /*!
  * \class Akonadi::Search::PIM::ContactCompleter
  * \inheader AkonadiSearch/PIM/ContactCompleter
@@ -27,6 +27,10 @@ namespace PIM
  * ContactCompleter provides email address auto-completion based on a prefix
  * string, searching through indexed contacts.
  *
+ * The contacts are kept in memory once loaded and refreshed when the index
+ * changes, so completing on every keystroke is cheap. ContactCompleter can
+ * be used from any thread.
+ *
  */
 class AKONADI_SEARCH_PIM_EXPORT ContactCompleter
 {
@@ -44,6 +48,18 @@ public:
      */
     [[nodiscard]] QStringList complete() const;
 
+    /*!
+     * \brief Completes the prefix in a thread of the global thread pool.
+     * \param owner Identifies the caller, such as the line edit the user types
+     * in. Starting another asynchronous completion or contact query for the
+     * same owner cancels this one. When the prefix extends the previous one
+     * completed for the same owner, its contacts are refined instead of
+     * searched again.
+     * \return A future with the completed contact list, canceled when the
+     * completion was canceled.
+     */
+    [[nodiscard]] QFuture<QStringList> completeAsync(const void *owner = nullptr) const;
+
 private:
     const QString m_prefix;
     const int m_limit;
@@ -0,0 +1,418 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include "contactcompletionindex_p.h"
+
+#include "akonadi_search_pim_debug.h"
+#include "query.h"
+#include "search/email/contactchanges.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+using namespace Akonadi::Search::PIM;
+using namespace Qt::Literals::StringLiterals;
+
+Q_GLOBAL_STATIC(ContactCompletionIndex, s_contactCompletionIndex)
+
+namespace
+{
+bool startsWith(const std::string &str, const std::string &prefix)
+{
+    return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+std::string toStdString(QStringView str)
+{
+    const QByteArray utf8 = str.toUtf8();
+    return std::string(utf8.constData(), utf8.size());
+}
+
+// Value slots of the statistics of a contact
+constexpr Xapian::valueno FrequencySlot = 1;
+constexpr Xapian::valueno LastSeenSlot = 2;
+
+double documentValue(const Xapian::Document &doc, Xapian::valueno slot)
+{
+    const std::string value = doc.get_value(slot);
+    return value.empty() ? 0.0 : Xapian::sortable_unserialise(value);
+}
+}
+
+ContactCompletionIndex *ContactCompletionIndex::instance()
+{
+    return s_contactCompletionIndex;
+}
+
+QString ContactCompletionIndex::normalize(const QString &str)
+{
+    const QString denormalized = str.toLower().normalized(QString::NormalizationForm_KD);
+    QString cleanString;
+    cleanString.reserve(denormalized.size());
+    for (const QChar &ch : denormalized) {
+        const auto cat = ch.category();
+        if (cat != QChar::Mark_NonSpacing && cat != QChar::Mark_SpacingCombining && cat != QChar::Mark_Enclosing) {
+            cleanString.append(ch);
+        }
+    }
+    return cleanString.normalized(QString::NormalizationForm_KC);
+}
+
+double ContactCompletionIndex::Contact::score(double now) const
+{
+    // Halved for every three months without a message
+    constexpr double halfLife = 90 * 24 * 3600;
+    const double age = lastSeen > 0 ? std::max(0.0, now - lastSeen) : 4 * halfLife;
+    return std::max(frequency, 1.0) * std::exp2(-age / halfLife);
+}
+
+bool ContactCompletionIndex::Entry::hasKeyStartingWith(const std::string &prefix) const
+{
+    return std::any_of(keys.cbegin(), keys.cend(), [&prefix](const std::string &key) {
+        return startsWith(key, prefix);
+    });
+}
+
+std::shared_ptr<const ContactCompletionIndex::Entry> ContactCompletionIndex::makeEntry(const Xapian::Document &doc)
+{
+    auto entry = std::make_shared<Entry>();
+    entry->display = QString::fromStdString(doc.get_data());
+
+    // "Name <address>" or just "address"
+    entry->collapseKey = doc.get_value(0);
+
+    const QString normalized = normalize(entry->display);
+    QStringView address(normalized);
+    const qsizetype open = normalized.lastIndexOf(u'<');
+    if (open >= 0 && normalized.endsWith(u'>')) {
+        address = address.mid(open + 1, address.size() - open - 2);
+    }
+    if (!address.isEmpty()) {
+        entry->keys.push_back(toStdString(address));
+    }
+
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= normalized.size(); ++i) {
+        const bool isWordChar = i < normalized.size() && normalized.at(i).isLetterOrNumber();
+        if (isWordChar && start < 0) {
+            start = i;
+        } else if (!isWordChar && start >= 0) {
+            entry->keys.push_back(toStdString(QStringView(normalized).mid(start, i - start)));
+            start = -1;
+        }
+    }
+
+    if (entry->collapseKey.empty()) {
+        entry->collapseKey = toStdString(address);
+    }
+
+    std::sort(entry->keys.begin(), entry->keys.end());
+    entry->keys.erase(std::unique(entry->keys.begin(), entry->keys.end()), entry->keys.end());
+    return entry;
+}
+
+std::shared_ptr<const ContactCompletionIndex::Snapshot> ContactCompletionIndex::rebuild(const Snapshot *previous)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->uuid = m_db->get_uuid();
+    snapshot->revision = m_db->get_revision();
+    snapshot->contacts.reserve(m_db->get_doccount());
+
+    int loaded = 0;
+    const Xapian::PostingIterator end = m_db->postlist_end(std::string());
+    for (Xapian::PostingIterator it = m_db->postlist_begin(std::string()); it != end; ++it) {
+        const Xapian::docid docid = *it;
+        if (previous) {
+            const auto known = previous->contacts.find(docid);
+            if (known != previous->contacts.cend()) {
+                snapshot->contacts.emplace(docid, std::make_shared<Contact>(Contact{known->second->entry}));
+                continue;
+            }
+        }
+        snapshot->contacts.emplace(docid, std::make_shared<Contact>(Contact{makeEntry(m_db->get_document(docid))}));
+        ++loaded;
+    }
+
+    // Statistics change on every message, stream them instead of loading documents
+    const auto readValues = [this, &snapshot](Xapian::valueno slot, double Contact::*field) {
+        for (Xapian::ValueIterator it = m_db->valuestream_begin(slot), end = m_db->valuestream_end(slot); it != end; ++it) {
+            const auto contact = snapshot->contacts.find(it.get_docid());
+            if (contact != snapshot->contacts.end()) {
+                contact->second.get()->*field = Xapian::sortable_unserialise(*it);
+            }
+        }
+    };
+    readValues(FrequencySlot, &Contact::frequency);
+    readValues(LastSeenSlot, &Contact::lastSeen);
+
+    for (const auto &[docid, contact] : snapshot->contacts) {
+        for (const std::string &key : contact->entry->keys) {
+            snapshot->keys.emplace_back(key, contact.get());
+        }
+    }
+    std::sort(snapshot->keys.begin(), snapshot->keys.end());
+
+    qCDebug(AKONADI_SEARCH_PIM_LOG) << "Completion index has" << snapshot->contacts.size() << "contacts," << loaded << "loaded in" << timer.elapsed() << "ms";
+    return snapshot;
+}
+
+std::shared_ptr<const ContactCompletionIndex::Snapshot> ContactCompletionIndex::update(const Snapshot &previous)
+{
+    const Xapian::rev revision = m_db->get_revision();
+    if (m_db->get_uuid() != previous.uuid || revision < previous.revision || revision - previous.revision > MaxContactChangeRevisions) {
+        return {};
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<Xapian::docid> changed;
+    for (Xapian::rev rev = previous.revision + 1; rev <= revision; ++rev) {
+        const std::string changes = m_db->get_metadata(contactChangesKey(rev));
+        // Dropped from the history, or committed by an indexer not listing its changes
+        if (changes.empty()) {
+            return {};
+        }
+        const std::vector<Xapian::docid> ids = deserializeContactIds(changes);
+        changed.insert(changed.end(), ids.cbegin(), ids.cend());
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->uuid = previous.uuid;
+    snapshot->revision = revision;
+    snapshot->contacts = previous.contacts;
+
+    std::vector<const Contact *> dropped;
+    std::vector<std::pair<std::string, const Contact *>> added;
+    for (const Xapian::docid docid : changed) {
+        std::shared_ptr<const Entry> entry;
+        const auto known = snapshot->contacts.find(docid);
+        if (known != snapshot->contacts.end()) {
+            dropped.push_back(known->second.get());
+            entry = known->second->entry;
+            snapshot->contacts.erase(known);
+        }
+
+        Xapian::Document doc;
+        try {
+            doc = m_db->get_document(docid);
+        } catch (const Xapian::DocNotFoundError &) {
+            continue;
+        }
+        if (!entry || entry->display != QString::fromStdString(doc.get_data())) {
+            entry = makeEntry(doc);
+        }
+        auto contact = std::make_shared<Contact>(Contact{entry, documentValue(doc, FrequencySlot), documentValue(doc, LastSeenSlot)});
+        for (const std::string &key : entry->keys) {
+            added.emplace_back(key, contact.get());
+        }
+        snapshot->contacts.emplace(docid, std::move(contact));
+    }
+
+    // Merge the keys of the changed contacts into the kept ones, both sorted
+    std::sort(dropped.begin(), dropped.end());
+    std::sort(added.begin(), added.end());
+    std::vector<std::pair<std::string, const Contact *>> kept;
+    kept.reserve(previous.keys.size());
+    std::copy_if(previous.keys.cbegin(), previous.keys.cend(), std::back_inserter(kept), [&dropped](const auto &key) {
+        return !std::binary_search(dropped.cbegin(), dropped.cend(), key.second);
+    });
+    snapshot->keys.reserve(kept.size() + added.size());
+    std::merge(kept.cbegin(), kept.cend(), added.cbegin(), added.cend(), std::back_inserter(snapshot->keys));
+
+    qCDebug(AKONADI_SEARCH_PIM_LOG) << "Completion index has" << snapshot->contacts.size() << "contacts," << changed.size() << "updated in" << timer.elapsed()
+                                    << "ms";
+    return snapshot;
+}
+
+std::shared_ptr<const ContactCompletionIndex::Snapshot> ContactCompletionIndex::snapshot()
+{
+    std::shared_ptr<const Snapshot> current;
+    {
+        QMutexLocker lock(&m_mutex);
+        current = m_snapshot;
+    }
+
+    // One thread refreshes the index, the others keep completing on the current snapshot
+    std::unique_lock<QMutex> updateLock(m_updateMutex, std::try_to_lock);
+    if (!updateLock.owns_lock()) {
+        if (current) {
+            return current;
+        }
+        updateLock.lock();
+    }
+    // Only replaced with the update lock held
+    current = m_snapshot;
+
+    if (!m_db) {
+        const QString dir = Query::defaultLocation(u"emailContacts"_s);
+        try {
+            m_db = std::make_unique<Xapian::Database>(QFile::encodeName(dir).toStdString());
+        } catch (const Xapian::DatabaseOpeningError &) {
+            qCWarning(AKONADI_SEARCH_PIM_LOG) << "Xapian Database does not exist at " << dir;
+            return {};
+        } catch (const Xapian::DatabaseError &e) {
+            qCWarning(AKONADI_SEARCH_PIM_LOG) << QString::fromStdString(e.get_type()) << QString::fromStdString(e.get_description());
+            return {};
+        }
+    }
+
+    int retryCount = 0;
+    for (;;) {
+        try {
+            // Also catches up after a failed refresh
+            m_db->reopen();
+            if (!current || current->revision != m_db->get_revision()) {
+                std::shared_ptr<const Snapshot> refreshed = current ? update(*current) : nullptr;
+                if (!refreshed) {
+                    refreshed = rebuild(current.get());
+                }
+                current = std::move(refreshed);
+                QMutexLocker lock(&m_mutex);
+                m_snapshot = current;
+            }
+            return current;
+        } catch (const Xapian::DatabaseCorruptError &e) {
+            qCWarning(AKONADI_SEARCH_PIM_LOG) << "The emailContacts Xapian database is corrupted:" << QString::fromStdString(e.get_description());
+            return current;
+        } catch (const Xapian::DatabaseModifiedError &e) {
+            if (++retryCount > 3) {
+                qCWarning(AKONADI_SEARCH_PIM_LOG) << "The emailContacts Xapian database seems broken:" << QString::fromStdString(e.get_description());
+                return current;
+            }
+            continue; // try again
+        } catch (const Xapian::Error &e) {
+            qCWarning(AKONADI_SEARCH_PIM_LOG) << QString::fromStdString(e.get_type()) << QString::fromStdString(e.get_description());
+            return current;
+        }
+    }
+}
+
+QStringList ContactCompletionIndex::complete(const QString &prefix, int limit, const std::function<bool()> &isCancelled, const void *client)
+{
+    std::vector<std::string> words;
+    const QString normalized = normalize(prefix);
+    const auto parts = QStringView(normalized).split(u' ', Qt::SkipEmptyParts);
+    for (const QStringView part : parts) {
+        words.push_back(toStdString(part));
+    }
+    if (words.empty() || limit <= 0) {
+        return {};
+    }
+
+    const std::shared_ptr<const Snapshot> current = snapshot();
+    if (!current || (isCancelled && isCancelled())) {
+        return {};
+    }
+
+    const auto matchesWords = [&words](const Entry *entry, std::size_t skippedWord) {
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            if (i != skippedWord && !entry->hasKeyStartingWith(words[i])) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    Candidates candidates{toStdString(normalized), current, {}};
+    const std::optional<Candidates> previous = m_sessions.find(client, current->revision);
+    if (previous && startsWith(candidates.prefix, previous->prefix)) {
+        // Every word of the new prefix extends a word of the previous one, or is a new word,
+        // so the previous candidates hold all the new ones
+        for (std::size_t i = 0; i < previous->contacts.size(); ++i) {
+            if (isCancelled && i % 1024 == 1023 && isCancelled()) {
+                return {};
+            }
+            const Contact *contact = previous->contacts[i];
+            if (matchesWords(contact->entry.get(), words.size())) {
+                candidates.contacts.push_back(contact);
+            }
+        }
+    } else {
+        // Start from the word with the fewest keys, check the others per contact
+        using KeyIterator = std::vector<std::pair<std::string, const Contact *>>::const_iterator;
+        std::pair<KeyIterator, KeyIterator> range{current->keys.cend(), current->keys.cend()};
+        std::size_t rangeWord = 0;
+        for (std::size_t i = 0; i < words.size(); ++i) {
+            const std::string &word = words[i];
+            const auto first = std::lower_bound(current->keys.cbegin(), current->keys.cend(), word, [](const auto &key, const std::string &value) {
+                return key.first < value;
+            });
+            const auto last = std::partition_point(first, current->keys.cend(), [&word](const auto &key) {
+                return startsWith(key.first, word);
+            });
+            if (first == last) {
+                m_sessions.store(client, current->revision, std::move(candidates));
+                return {};
+            }
+            if (i == 0 || last - first < range.second - range.first) {
+                range = {first, last};
+                rangeWord = i;
+            }
+        }
+
+        for (auto it = range.first; it != range.second; ++it) {
+            // Short prefixes match most contacts, give up early when outdated
+            if (isCancelled && (it - range.first) % 1024 == 1023 && isCancelled()) {
+                return {};
+            }
+            if (matchesWords(it->second->entry.get(), rangeWord)) {
+                candidates.contacts.push_back(it->second);
+            }
+        }
+        // A contact is listed once per key starting with the word
+        std::sort(candidates.contacts.begin(), candidates.contacts.end());
+        candidates.contacts.erase(std::unique(candidates.contacts.begin(), candidates.contacts.end()), candidates.contacts.end());
+    }
+
+    // Keep the best ranked contact of every address
+    const double now = static_cast<double>(QDateTime::currentSecsSinceEpoch());
+    std::unordered_map<std::string_view, std::pair<const Contact *, double>> best;
+    for (const Contact *contact : std::as_const(candidates.contacts)) {
+        const double score = contact->score(now);
+        const auto [found, inserted] = best.try_emplace(contact->entry->collapseKey, contact, score);
+        if (!inserted && score > found->second.second) {
+            found->second = {contact, score};
+        }
+    }
+
+    std::vector<std::pair<const Contact *, double>> matches;
+    matches.reserve(best.size());
+    for (const auto &[key, match] : best) {
+        matches.push_back(match);
+    }
+    const auto byScore = [](const std::pair<const Contact *, double> &a, const std::pair<const Contact *, double> &b) {
+        if (a.second != b.second) {
+            return a.second > b.second;
+        }
+        return a.first->entry->display.compare(b.first->entry->display, Qt::CaseInsensitive) < 0;
+    };
+    const auto count = std::min<std::size_t>(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), byScore);
+
+    QStringList list;
+    list.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        list.push_back(matches[i].first->entry->display);
+    }
+    m_sessions.store(client, current->revision, std::move(candidates));
+    return list;
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include "querysessioncache_p.h"
+
+#include <xapian.h>
+
+#include <QMutex>
+#include <QStringList>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Akonadi
+{
+namespace Search
+{
+namespace PIM
+{
+/*
+ * Process wide, in-memory prefix index of the emailContacts database.
+ *
+ * Every contact is indexed under the normalized words of its name and its
+ * address, in one sorted table, so a completion is a couple of binary
+ * searches. The table is loaded on first use. When the database revision
+ * changes, only the contacts the indexer listed as changed are read again
+ * and merged into a copy of the table, unless the change list is gone.
+ *
+ * Contacts sharing an address are collapsed, and ranked by how often and
+ * how recently we corresponded with them.
+ *
+ * Completions run on an immutable snapshot, so any number of threads can
+ * use the index while one of them refreshes it.
+ *
+ * Completions for a client refine the contacts its previous prefix matched
+ * when the new prefix extends it.
+ */
+class ContactCompletionIndex
+{
+public:
+    static ContactCompletionIndex *instance();
+
+    /// Returns nothing once @p isCancelled returns true, @p client identifies the session to refine
+    [[nodiscard]] QStringList complete(const QString &prefix, int limit, const std::function<bool()> &isCancelled = {}, const void *client = nullptr);
+
+    /// Lower case, without accents
+    [[nodiscard]] static QString normalize(const QString &str);
+
+private:
+    struct Entry {
+        QString display;
+        // Normalized address, from value slot 0
+        std::string collapseKey;
+        std::vector<std::string> keys;
+
+        [[nodiscard]] bool hasKeyStartingWith(const std::string &prefix) const;
+    };
+
+    // The entry does not change, its statistics do
+    struct Contact {
+        std::shared_ptr<const Entry> entry;
+        double frequency = 0.0;
+        double lastSeen = 0.0;
+
+        [[nodiscard]] double score(double now) const;
+    };
+
+    struct Snapshot {
+        std::string uuid;
+        Xapian::rev revision = 0;
+        // Unchanged contacts are shared with the previous snapshot
+        std::unordered_map<Xapian::docid, std::shared_ptr<Contact>> contacts;
+        // Sorted by key, the contacts are owned by the map above
+        std::vector<std::pair<std::string, const Contact *>> keys;
+    };
+
+    // Every contact matching all the words of the prefix, before collapsing
+    struct Candidates {
+        std::string prefix;
+        std::shared_ptr<const Snapshot> snapshot;
+        std::vector<const Contact *> contacts;
+    };
+
+    [[nodiscard]] std::shared_ptr<const Snapshot> snapshot();
+    [[nodiscard]] std::shared_ptr<const Snapshot> rebuild(const Snapshot *previous);
+    [[nodiscard]] std::shared_ptr<const Snapshot> update(const Snapshot &previous);
+    [[nodiscard]] static std::shared_ptr<const Entry> makeEntry(const Xapian::Document &doc);
+
+    // Held by the thread refreshing the index, guards the database
+    QMutex m_updateMutex;
+    std::unique_ptr<Xapian::Database> m_db;
+    // Only guards the current snapshot
+    QMutex m_mutex;
+    std::shared_ptr<const Snapshot> m_snapshot;
+    QuerySessionCache<Candidates> m_sessions;
+};
+}
+}
+}
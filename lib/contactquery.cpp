@@ -10,12 +10,16 @@
 
 #include "akonadi_search_pim_debug.h"
 #include "contactquery.h"
+#include "querycancellation_p.h"
+#include "querysessioncache_p.h"
 #include "resultiterator_p.h"
 
 #include <QFile>
 #include <QList>
 #include <QStandardPaths>
 
+#include <algorithm>
+
 using namespace Akonadi::Search::PIM;
 using namespace Qt::Literals::StringLiterals;
 class Akonadi::Search::PIM::ContactQueryPrivate
@@ -27,10 +31,107 @@ public:
     QString uid;
     QString any;
 
-    int limit;
+    int limit = 0;
     ContactQuery::MatchCriteria criteria;
 };
 
+namespace
+{
+// Xapian only expands a partial term to its 100 most frequent completions
+constexpr Xapian::termcount MaxPartialExpansion = 100;
+
+// The complete results of a single word StartsWithMatch query
+struct ContactQuerySession {
+    std::vector<std::string> terms;
+    std::vector<Xapian::docid> ids;
+};
+
+Q_GLOBAL_STATIC(QuerySessionCache<ContactQuerySession>, s_sessions)
+
+bool hasPrefix(const std::string &str, const std::string &prefix)
+{
+    return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+/*
+ * The partial term every field of a StartsWithMatch query looks for, empty
+ * for the unused fields. Returns nothing when a field is not a single word,
+ * the parser would then split it into several terms.
+ */
+std::vector<std::string> partialTerms(const ContactQueryPrivate &d)
+{
+    if (d.criteria != ContactQuery::StartsWithMatch) {
+        return {};
+    }
+
+    const std::pair<const QString &, const char *> fields[] = {
+        {d.any, ""},
+        {d.name, "NA"},
+        {d.nick, "NI"},
+        {d.email, ""},
+        {d.uid, "UID"},
+    };
+    std::vector<std::string> terms;
+    for (const auto &[value, prefix] : fields) {
+        if (!std::all_of(value.cbegin(), value.cend(), [](QChar ch) {
+                return ch.isLetterOrNumber();
+            })) {
+            return {};
+        }
+        terms.push_back(value.isEmpty() ? std::string() : prefix + value.toLower().toStdString());
+    }
+    if (std::all_of(terms.cbegin(), terms.cend(), [](const std::string &term) {
+            return term.empty();
+        })) {
+        return {};
+    }
+    return terms;
+}
+
+// Whether all the matches of @p previous are among the ones of @p terms
+bool extends(const std::vector<std::string> &terms, const std::vector<std::string> &previous)
+{
+    if (terms.size() != previous.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < terms.size(); ++i) {
+        if (terms[i].empty() != previous[i].empty() || !hasPrefix(terms[i], previous[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool hasTermStartingWith(const Xapian::Document &doc, const std::vector<std::string> &terms)
+{
+    return std::any_of(terms.cbegin(), terms.cend(), [&doc](const std::string &term) {
+        if (term.empty()) {
+            return false;
+        }
+        Xapian::TermIterator it = doc.termlist_begin();
+        it.skip_to(term);
+        return it != doc.termlist_end() && hasPrefix(*it, term);
+    });
+}
+
+// Xapian may have left out completions of a short partial term
+bool isExpansionLimited(const Xapian::Database &db, const std::vector<std::string> &terms)
+{
+    return std::any_of(terms.cbegin(), terms.cend(), [&db](const std::string &term) {
+        if (term.empty()) {
+            return false;
+        }
+        Xapian::termcount count = 0;
+        for (Xapian::TermIterator it = db.allterms_begin(term), end = db.allterms_end(term); it != end; ++it) {
+            if (++count > MaxPartialExpansion) {
+                return true;
+            }
+        }
+        return false;
+    });
+}
+}
+
 ContactQuery::ContactQuery()
     : d(new ContactQueryPrivate)
 {
@@ -85,6 +186,20 @@ void ContactQuery::setMatchCriteria(ContactQuery::MatchCriteria m)
 }
 
 ResultIterator ContactQuery::exec()
+{
+    return exec(nullptr, std::function<bool()>());
+}
+
+QFuture<ResultIterator> ContactQuery::execAsync(const void *owner) const
+{
+    return QueryCancellation::run<ResultIterator>(owner, [owner, data = *d](const std::function<bool()> &isCancelled) {
+        ContactQuery query;
+        *query.d = data;
+        return query.exec(owner, isCancelled);
+    });
+}
+
+ResultIterator ContactQuery::exec(const void *client, const std::function<bool()> &isCancelled)
 {
     const QString dir = defaultLocation(u"contacts"_s);
     Xapian::Database db;
@@ -105,6 +220,37 @@ ResultIterator ContactQuery::exec()
         return {};
     }
 
+    if (d->limit == 0) {
+        d->limit = 10000;
+    }
+
+    const std::vector<std::string> terms = client ? partialTerms(*d) : std::vector<std::string>();
+    if (!terms.empty()) {
+        try {
+            const Xapian::rev revision = db.get_revision();
+            const std::optional<ContactQuerySession> previous = s_sessions->find(client, revision);
+            if (previous && extends(terms, previous->terms)) {
+                ContactQuerySession session{terms, {}};
+                for (std::size_t i = 0; i < previous->ids.size(); ++i) {
+                    if (isCancelled && i % 64 == 63 && isCancelled()) {
+                        return {};
+                    }
+                    if (hasTermStartingWith(db.get_document(previous->ids[i]), terms)) {
+                        session.ids.push_back(previous->ids[i]);
+                    }
+                }
+                const auto count = std::min<std::size_t>(d->limit, session.ids.size());
+                ResultIterator iter;
+                iter.d->init(db, std::vector<Xapian::docid>(session.ids.cbegin(), session.ids.cbegin() + count));
+                s_sessions->store(client, revision, std::move(session));
+                return iter;
+            }
+        } catch (const Xapian::Error &e) {
+            qCWarning(AKONADI_SEARCH_PIM_LOG) << "Failed to refine the previous results:" << QString::fromStdString(e.get_description());
+            s_sessions->remove(client);
+        }
+    }
+
     QList<Xapian::Query> m_queries;
 
     if (d->criteria == ExactMatch) {
@@ -179,15 +325,29 @@ ResultIterator ContactQuery::exec()
         Xapian::Enquire enquire(db);
         enquire.set_query(query);
 
-        if (d->limit == 0) {
-            d->limit = 10000;
+        Xapian::MSet matches;
+        if (isCancelled) {
+            const CancellationMatchDecider decider(isCancelled);
+            matches = enquire.get_mset(0, d->limit, nullptr, &decider);
+        } else {
+            matches = enquire.get_mset(0, d->limit);
         }
 
-        Xapian::MSet matches = enquire.get_mset(0, d->limit);
+        // Only results holding every match can be refined by the next keystrokes
+        if (!terms.empty() && matches.size() < static_cast<Xapian::doccount>(d->limit) && !isExpansionLimited(db, terms)) {
+            ContactQuerySession session{terms, {}};
+            session.ids.reserve(matches.size());
+            for (Xapian::MSetIterator it = matches.begin(); it != matches.end(); ++it) {
+                session.ids.push_back(*it);
+            }
+            s_sessions->store(client, db.get_revision(), std::move(session));
+        }
 
         ResultIterator iter;
         iter.d->init(matches);
         return iter;
+    } catch (const QueryCancelled &) {
+        return {};
     } catch (const Xapian::Error &e) {
         qCWarning(AKONADI_SEARCH_PIM_LOG) << QString::fromStdString(e.get_type()) << QString::fromStdString(e.get_description());
         return {};
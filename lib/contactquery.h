@@ -11,8 +11,10 @@
 #include "query.h"
 #include "search_pim_export.h"
 
+#include <QFuture>
 #include <QString>
 
+#include <functional>
 #include <memory>
 
 namespace Akonadi
@@ -68,6 +70,19 @@ public:
      */
     [[nodiscard]] ResultIterator exec() override;
 
+    /*!
+     * Runs the query in a thread of the global thread pool.
+     *
+     * \a owner identifies the caller. Starting another asynchronous contact
+     * query or completion for the same owner cancels this one, even while
+     * Xapian is matching. The returned future is canceled then.
+     *
+     * When a StartsWithMatch query only extends the words of the previous one
+     * of the same owner, its contacts are filtered out of the previous results
+     * instead of searched again. They keep the ranking of the previous query.
+     */
+    [[nodiscard]] QFuture<ResultIterator> execAsync(const void *owner = nullptr) const;
+
     /*!
      */
     [[nodiscard]] int limit() const;
@@ -76,6 +91,8 @@ public:
     void setLimit(int limit);
 
 private:
+    ResultIterator exec(const void *client, const std::function<bool()> &isCancelled);
+
     std::unique_ptr<ContactQueryPrivate> const d;
 };
 }
@@ -0,0 +1,104 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include "contactrecord.h"
+
+#include <QDataStream>
+#include <QIODevice>
+
+using namespace Akonadi::Search::PIM;
+
+namespace
+{
+// Bump when the layout written by toData() changes, older records are ignored
+constexpr quint8 ContactRecordVersion = 1;
+}
+
+class Akonadi::Search::PIM::ContactRecordPrivate : public QSharedData
+{
+public:
+    QString name;
+    QStringList emails;
+    QByteArray thumbnail;
+};
+
+ContactRecord::ContactRecord()
+    : d(new ContactRecordPrivate)
+{
+}
+
+ContactRecord::ContactRecord(const ContactRecord &other) = default;
+
+ContactRecord::~ContactRecord() = default;
+
+ContactRecord &ContactRecord::operator=(const ContactRecord &other) = default;
+
+QString ContactRecord::name() const
+{
+    return d->name;
+}
+
+void ContactRecord::setName(const QString &name)
+{
+    d->name = name;
+}
+
+QStringList ContactRecord::emails() const
+{
+    return d->emails;
+}
+
+void ContactRecord::setEmails(const QStringList &emails)
+{
+    d->emails = emails;
+}
+
+QByteArray ContactRecord::thumbnail() const
+{
+    return d->thumbnail;
+}
+
+void ContactRecord::setThumbnail(const QByteArray &png)
+{
+    d->thumbnail = png;
+}
+
+bool ContactRecord::isEmpty() const
+{
+    return d->name.isEmpty() && d->emails.isEmpty();
+}
+
+QByteArray ContactRecord::toData() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << ContactRecordVersion << d->name << d->emails << d->thumbnail;
+    return data;
+}
+
+ContactRecord ContactRecord::fromData(const QByteArray &data)
+{
+    ContactRecord record;
+    if (data.isEmpty()) {
+        return record;
+    }
+
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint8 version = 0;
+    stream >> version;
+    if (version != ContactRecordVersion) {
+        return record;
+    }
+    stream >> record.d->name >> record.d->emails >> record.d->thumbnail;
+    if (stream.status() != QDataStream::Ok) {
+        return {};
+    }
+    return record;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include "search_pim_export.h"
+
+#include <QByteArray>
+#include <QSharedDataPointer>
+#include <QStringList>
+
+namespace Akonadi
+{
+namespace Search
+{
+namespace PIM
+{
+class ContactRecordPrivate;
+
+/*!
+ * \class Akonadi::Search::PIM::ContactRecord
+ * \inheader AkonadiSearch/PIM/ContactRecord
+ * \inmodule AkonadiSearchPIM
+ * \brief Display data of an indexed contact.
+ *
+ * The indexer stores a ContactRecord along with each contact, so that the
+ * results of a ContactQuery can be shown without fetching the contacts
+ * from Akonadi.
+ *
+ * \sa ResultIterator::contactRecord()
+ */
+class AKONADI_SEARCH_PIM_EXPORT ContactRecord
+{
+public:
+    /*!
+     * \brief Constructs an empty contact record.
+     */
+    ContactRecord();
+    ContactRecord(const ContactRecord &other);
+    ~ContactRecord();
+    ContactRecord &operator=(const ContactRecord &other);
+
+    /*!
+     * \brief Returns the formatted name of the contact.
+     */
+    [[nodiscard]] QString name() const;
+    /*!
+     * \brief Sets the formatted name of the contact to \a name.
+     */
+    void setName(const QString &name);
+
+    /*!
+     * \brief Returns the email addresses of the contact.
+     */
+    [[nodiscard]] QStringList emails() const;
+    /*!
+     * \brief Sets the email addresses of the contact to \a emails.
+     */
+    void setEmails(const QStringList &emails);
+
+    /*!
+     * \brief Returns the PNG encoded thumbnail of the contact photo, or an
+     * empty array when the contact has no photo.
+     */
+    [[nodiscard]] QByteArray thumbnail() const;
+    /*!
+     * \brief Sets the PNG encoded thumbnail of the contact photo to \a png.
+     */
+    void setThumbnail(const QByteArray &png);
+
+    /*!
+     * \brief Returns \c true when the record has neither name nor emails.
+     */
+    [[nodiscard]] bool isEmpty() const;
+
+    /*!
+     * \brief Serializes the record into the document data of the index.
+     */
+    [[nodiscard]] QByteArray toData() const;
+    /*!
+     * \brief Deserializes a record written by toData().
+     *
+     * Returns an empty record when \a data is empty, comes from an older
+     * index or cannot be decoded.
+     */
+    [[nodiscard]] static ContactRecord fromData(const QByteArray &data);
+
+private:
+    QSharedDataPointer<ContactRecordPrivate> d;
+};
+}
+}
+}
@@ -9,16 +9,75 @@
 #include <xapian.h>
 
 #include "akonadi_search_pim_debug.h"
+#include "collectionquery.h"
 #include "emailquery.h"
 #include "resultiterator_p.h"
+#include "search/email/addressterms.h"
 #include "search/email/agepostingsource.h"
+#include "search/subtreequery.h"
 
 #include <QFile>
-#include <QRegularExpression>
 #include <QStandardPaths>
 
 using namespace Akonadi::Search::PIM;
 using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+// Domains ("@example.org" or "*@example.org") and complete addresses are
+// single terms per field, anything else goes through the query parser
+Xapian::Query structuredAddressQuery(const QString &str, std::initializer_list<const char *> fields)
+{
+    const Akonadi::Search::AddressFilter filter = Akonadi::Search::AddressFilter::parse(str);
+    if (!filter.isValid()) {
+        return {};
+    }
+
+    const std::string value = filter.value.toStdString();
+    std::vector<std::string> terms;
+    for (const char *field : fields) {
+        for (const Akonadi::Search::AddressTermKind kind : filter.kinds) {
+            terms.push_back(Akonadi::Search::addressTerm(kind, field, value));
+        }
+    }
+    return Xapian::Query(Xapian::Query::OP_OR, terms.cbegin(), terms.cend());
+}
+
+std::string messageIdentifier(const QString &messageId)
+{
+    QString id = messageId.trimmed();
+    if (id.startsWith(u'<') && id.endsWith(u'>')) {
+        id = id.mid(1, id.size() - 2);
+    }
+    return id.toStdString();
+}
+
+// All messages sharing the thread root of the message
+Xapian::Query threadQuery(const Xapian::Database &db, const std::string &messageId)
+{
+    std::string root = messageId;
+    const std::string idTerm = "XMI:" + messageId;
+    const Xapian::PostingIterator postIt = db.postlist_begin(idTerm);
+    if (postIt != db.postlist_end(idTerm)) {
+        Xapian::TermIterator it = db.termlist_begin(*postIt);
+        it.skip_to("XTR:");
+        if (it != db.termlist_end(*postIt) && (*it).compare(0, 4, "XTR:") == 0) {
+            root = (*it).substr(4);
+        }
+    }
+
+    const Xapian::Query queries[] = {
+        Xapian::Query("XTR:" + root),
+        Xapian::Query("XRF:" + root),
+        Xapian::Query("XMI:" + root),
+    };
+    return Xapian::Query(Xapian::Query::OP_OR, std::begin(queries), std::end(queries));
+}
+}
+
+// Whether the subtree terms can be trusted, for the current revision of the email index
+Q_GLOBAL_STATIC(Akonadi::Search::SubtreeQueries, s_subtreeQueries)
+
 class Akonadi::Search::PIM::EmailQueryPrivate
 {
 public:
@@ -31,6 +90,8 @@ public:
     QString from;
 
     QList<Akonadi::Collection::Id> collections;
+    QList<Akonadi::Collection::Id> excludedCollections;
+    QList<Akonadi::Tag::Id> tags;
 
     char important{'0'};
     char read{'0'};
@@ -40,6 +101,9 @@ public:
     QString subjectMatchString;
     QString bodyMatchString;
 
+    QString messageId;
+    QString threadOf;
+
     EmailQuery::OpType opType = EmailQuery::OpAnd;
     int limit = 0;
     bool splitSearchMatchString = true;
@@ -127,6 +191,26 @@ void EmailQuery::setCollection(const QList<Akonadi::Collection::Id> &collections
     d->collections = collections;
 }
 
+void EmailQuery::addExcludedCollection(Akonadi::Collection::Id id)
+{
+    d->excludedCollections << id;
+}
+
+void EmailQuery::setExcludedCollections(const QList<Akonadi::Collection::Id> &collections)
+{
+    d->excludedCollections = collections;
+}
+
+void EmailQuery::addTag(Akonadi::Tag::Id id)
+{
+    d->tags << id;
+}
+
+void EmailQuery::setTags(const QList<Akonadi::Tag::Id> &tags)
+{
+    d->tags = tags;
+}
+
 int EmailQuery::limit() const
 {
     return d->limit;
@@ -152,6 +236,16 @@ void EmailQuery::bodyMatches(const QString &bodyMatch)
     d->bodyMatchString = bodyMatch;
 }
 
+void EmailQuery::setMessageId(const QString &messageId)
+{
+    d->messageId = messageId;
+}
+
+void EmailQuery::setThreadOf(const QString &messageId)
+{
+    d->threadOf = messageId;
+}
+
 void EmailQuery::setAttachment(bool hasAttachment)
 {
     d->attachment = hasAttachment ? 'T' : 'F';
@@ -199,6 +293,11 @@ ResultIterator EmailQuery::exec()
 
         // vHanda: Do we really need the query parser over here?
         for (const QString &str : std::as_const(d->involves)) {
+            const Xapian::Query q = structuredAddressQuery(str, {"F", "T", "CC", "BC"});
+            if (!q.empty()) {
+                m_queries << q;
+                continue;
+            }
             const QByteArray ba = str.toUtf8();
             m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
         }
@@ -208,8 +307,13 @@ ResultIterator EmailQuery::exec()
         Xapian::QueryParser parser;
         parser.set_database(db);
         parser.add_prefix("", "F");
-        const QByteArray ba = d->from.toUtf8();
-        m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
+        const Xapian::Query q = structuredAddressQuery(d->from, {"F"});
+        if (!q.empty()) {
+            m_queries << q;
+        } else {
+            const QByteArray ba = d->from.toUtf8();
+            m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
+        }
     }
 
     if (!d->to.isEmpty()) {
@@ -218,6 +322,11 @@ ResultIterator EmailQuery::exec()
         parser.add_prefix("", "T");
 
         for (const QString &str : std::as_const(d->to)) {
+            const Xapian::Query q = structuredAddressQuery(str, {"T"});
+            if (!q.empty()) {
+                m_queries << q;
+                continue;
+            }
             const QByteArray ba = str.toUtf8();
             m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
         }
@@ -229,6 +338,11 @@ ResultIterator EmailQuery::exec()
         parser.add_prefix("", "CC");
 
         for (const QString &str : std::as_const(d->cc)) {
+            const Xapian::Query q = structuredAddressQuery(str, {"CC"});
+            if (!q.empty()) {
+                m_queries << q;
+                continue;
+            }
             const QByteArray ba = str.toUtf8();
             m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
         }
@@ -240,6 +354,11 @@ ResultIterator EmailQuery::exec()
         parser.add_prefix("", "BC");
 
         for (const QString &str : std::as_const(d->bcc)) {
+            const Xapian::Query q = structuredAddressQuery(str, {"BC"});
+            if (!q.empty()) {
+                m_queries << q;
+                continue;
+            }
             const QByteArray ba = str.toUtf8();
             m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
         }
@@ -255,15 +374,24 @@ ResultIterator EmailQuery::exec()
     }
 
     if (!d->collections.isEmpty()) {
-        Xapian::Query query;
-        for (Akonadi::Collection::Id id : std::as_const(d->collections)) {
-            const QString c = QString::number(id);
-            const Xapian::Query q = Xapian::Query('C' + c.toStdString());
-
-            query = Xapian::Query(Xapian::Query::OP_OR, query, q);
+        // Whole subtrees are matched by the term of their root, when the items below it agree
+        const CollectionQuery::Subtrees subtrees = CollectionQuery().subtrees(d->collections);
+        std::vector<Xapian::Query> queries;
+        for (Akonadi::Collection::Id id : subtrees.roots) {
+            queries.push_back(s_subtreeQueries->query(db, id, subtrees.members.value(id)));
         }
+        for (Akonadi::Collection::Id id : subtrees.collections) {
+            queries.emplace_back('C' + std::to_string(id));
+        }
+        m_queries << Xapian::Query(Xapian::Query::OP_OR, queries.cbegin(), queries.cend());
+    }
 
-        m_queries << query;
+    if (!d->tags.isEmpty()) {
+        std::vector<std::string> terms;
+        for (Akonadi::Tag::Id id : std::as_const(d->tags)) {
+            terms.push_back("XTG:" + std::to_string(id));
+        }
+        m_queries << Xapian::Query(Xapian::Query::OP_OR, terms.cbegin(), terms.cend());
     }
 
     if (!d->bodyMatchString.isEmpty()) {
@@ -275,6 +403,19 @@ ResultIterator EmailQuery::exec()
         m_queries << parser.parse_query(ba.constData(), Xapian::QueryParser::FLAG_PARTIAL);
     }
 
+    if (!d->messageId.isEmpty()) {
+        m_queries << Xapian::Query("XMI:" + messageIdentifier(d->messageId));
+    }
+
+    if (!d->threadOf.isEmpty()) {
+        try {
+            m_queries << threadQuery(db, messageIdentifier(d->threadOf));
+        } catch (const Xapian::Error &e) {
+            qCWarning(AKONADI_SEARCH_PIM_LOG) << QString::fromStdString(e.get_type()) << QString::fromStdString(e.get_description());
+            return {};
+        }
+    }
+
     if (d->important == 'T') {
         m_queries << Xapian::Query("BI");
     } else if (d->important == 'F') {
@@ -318,6 +459,14 @@ ResultIterator EmailQuery::exec()
         break;
     }
 
+    if (!d->excludedCollections.isEmpty()) {
+        std::vector<std::string> terms;
+        for (Akonadi::Collection::Id id : std::as_const(d->excludedCollections)) {
+            terms.push_back("XCA:" + std::to_string(id));
+        }
+        query = Xapian::Query(Xapian::Query::OP_AND_NOT, query, Xapian::Query(Xapian::Query::OP_OR, terms.cbegin(), terms.cend()));
+    }
+
     AgePostingSource ps(0);
     query = Xapian::Query(Xapian::Query::OP_AND_MAYBE, query, Xapian::Query(&ps));
 
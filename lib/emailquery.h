@@ -12,6 +12,7 @@
 #include "search_pim_export.h"
 
 #include <Akonadi/Collection>
+#include <Akonadi/Tag>
 #include <QStringList>
 
 #include <memory>
@@ -34,6 +35,11 @@ class EmailQueryPrivate;
  * sender, recipient, subject, body, collections, attachment status,
  * and importance/read flags.
  *
+ * Address filters given as a complete address ("john@example.org") match
+ * it exactly, and filters given as a domain ("@example.org") match all
+ * addresses of the domain or of its subdomains. Anything else is a partial
+ * match on names and addresses.
+ *
  * \sa Query, ResultIterator
  */
 class AKONADI_SEARCH_PIM_EXPORT EmailQuery : public Query
@@ -136,6 +142,9 @@ public:
 
     /*!
      * \brief Sets the collections to search in.
+     *
+     * A folder listed together with all its subfolders is searched with a
+     * single subtree term.
      * \param collections The list of collection IDs.
      * \sa addCollection()
      */
@@ -147,6 +156,34 @@ public:
      */
     void addCollection(Akonadi::Collection::Id id);
 
+    /*!
+     * \brief Sets the collections left out of the search, with all their subfolders.
+     *
+     * Meant for folders such as Trash or Spam, each of them costs a single term.
+     * \param collections The list of collection IDs.
+     * \sa addExcludedCollection()
+     */
+    void setExcludedCollections(const QList<Akonadi::Collection::Id> &collections);
+    /*!
+     * \brief Leaves a collection and its subfolders out of the search.
+     * \param id The collection ID to exclude.
+     * \sa setExcludedCollections()
+     */
+    void addExcludedCollection(Akonadi::Collection::Id id);
+
+    /*!
+     * \brief Sets the tags to filter by, emails with any of them match.
+     * \param tags The list of tag IDs.
+     * \sa addTag()
+     */
+    void setTags(const QList<Akonadi::Tag::Id> &tags);
+    /*!
+     * \brief Adds a tag to the tag filter.
+     * \param id The tag ID to add.
+     * \sa setTags()
+     */
+    void addTag(Akonadi::Tag::Id id);
+
     /*!
      * \brief Filters for important emails.
      * \param important \c true to search for important emails only. By default ignored.
@@ -183,6 +220,19 @@ public:
      */
     void bodyMatches(const QString &bodyMatch);
 
+    /*!
+     * \brief Matches the emails with the given Message-ID, that is the
+     * email and its duplicates.
+     * \param messageId The Message-ID, with or without angle brackets.
+     */
+    void setMessageId(const QString &messageId);
+
+    /*!
+     * \brief Matches all emails in the thread of the email with the given Message-ID.
+     * \param messageId The Message-ID, with or without angle brackets.
+     */
+    void setThreadOf(const QString &messageId);
+
     /*!
      * \brief Sets the maximum number of results to return.
      * \param limit The result limit.
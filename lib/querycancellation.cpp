@@ -0,0 +1,66 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#include "querycancellation_p.h"
+
+#include <QHash>
+#include <QMutex>
+
+using namespace Akonadi::Search::PIM;
+
+namespace
+{
+QMutex s_mutex;
+QHash<const void *, QueryCancellation::Token> s_running;
+
+// Checking a flag is cheap, but not free for every candidate
+constexpr unsigned int CheckInterval = 256;
+}
+
+QueryCancellation::Token QueryCancellation::start(const void *owner)
+{
+    auto token = std::make_shared<std::atomic_bool>(false);
+    if (!owner) {
+        return token;
+    }
+
+    QMutexLocker lock(&s_mutex);
+    const Token previous = s_running.value(owner);
+    if (previous) {
+        previous->store(true, std::memory_order_relaxed);
+    }
+    s_running.insert(owner, token);
+    return token;
+}
+
+void QueryCancellation::finish(const void *owner, const Token &token)
+{
+    if (!owner) {
+        return;
+    }
+
+    QMutexLocker lock(&s_mutex);
+    const auto it = s_running.constFind(owner);
+    if (it != s_running.cend() && *it == token) {
+        s_running.erase(it);
+    }
+}
+
+CancellationMatchDecider::CancellationMatchDecider(const std::function<bool()> &isCancelled)
+    : m_isCancelled(isCancelled)
+{
+}
+
+bool CancellationMatchDecider::operator()(const Xapian::Document &doc) const
+{
+    Q_UNUSED(doc)
+    if (++m_calls % CheckInterval == 0 && m_isCancelled()) {
+        throw QueryCancelled();
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <xapian.h>
+
+#include <QPromise>
+#include <QThreadPool>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace Akonadi
+{
+namespace Search
+{
+namespace PIM
+{
+/*
+ * Cooperative cancellation of asynchronous queries.
+ *
+ * Every asynchronous query belongs to an owner, such as the widget the
+ * user types in. Starting a query cancels the one still running for the
+ * same owner, the running query notices it the next time it checks.
+ */
+class QueryCancellation
+{
+public:
+    using Token = std::shared_ptr<std::atomic_bool>;
+
+    /// Cancels the query running for @p owner and returns the token of the new one
+    [[nodiscard]] static Token start(const void *owner);
+    /// Forgets @p token if it still is the one of @p owner
+    static void finish(const void *owner, const Token &token);
+
+    /// Runs @p query in the global thread pool, the future is canceled with the query
+    template<typename T>
+    static QFuture<T> run(const void *owner, std::function<T(const std::function<bool()> &isCancelled)> query)
+    {
+        auto promise = std::make_shared<QPromise<T>>();
+        QFuture<T> future = promise->future();
+        const Token token = start(owner);
+        promise->start();
+        QThreadPool::globalInstance()->start([owner, token, promise, query = std::move(query)]() {
+            const std::function<bool()> isCancelled = [&token, &promise]() {
+                return token->load(std::memory_order_relaxed) || promise->isCanceled();
+            };
+            if (!isCancelled()) {
+                T result = query(isCancelled);
+                if (!isCancelled()) {
+                    promise->addResult(std::move(result));
+                } else {
+                    promise->future().cancel();
+                }
+            } else {
+                promise->future().cancel();
+            }
+            promise->finish();
+            finish(owner, token);
+        });
+        return future;
+    }
+};
+
+/// Thrown out of Enquire::get_mset() when the query was cancelled
+struct QueryCancelled {
+};
+
+/*
+ * Checks for cancellation while Xapian matches, and aborts the match by
+ * throwing QueryCancelled.
+ */
+class CancellationMatchDecider : public Xapian::MatchDecider
+{
+public:
+    explicit CancellationMatchDecider(const std::function<bool()> &isCancelled);
+
+    bool operator()(const Xapian::Document &doc) const override;
+
+private:
+    const std::function<bool()> &m_isCancelled;
+    mutable unsigned int m_calls = 0;
+};
+}
+}
+}
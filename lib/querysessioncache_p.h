@@ -0,0 +1,107 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <xapian.h>
+
+#include <QHash>
+#include <QMutex>
+
+#include <algorithm>
+#include <optional>
+
+namespace Akonadi
+{
+namespace Search
+{
+namespace PIM
+{
+/*
+ * The last results of each client of a search-as-you-type query.
+ *
+ * Clients send strictly growing prefixes, whose matches are a subset of
+ * the ones of the previous prefix. Queries keep their complete candidates
+ * here, keyed by the owner of the asynchronous query, so that the next
+ * keystroke can filter them instead of running another enquiry.
+ *
+ * Candidates are only valid for the database revision they were found at.
+ */
+template<typename T>
+class QuerySessionCache
+{
+public:
+    /// Returns what @p client stored at @p revision, if anything
+    [[nodiscard]] std::optional<T> find(const void *client, Xapian::rev revision)
+    {
+        if (!client) {
+            return std::nullopt;
+        }
+
+        QMutexLocker lock(&m_mutex);
+        const auto it = m_sessions.find(client);
+        if (it == m_sessions.end()) {
+            return std::nullopt;
+        }
+        if (it->revision != revision) {
+            m_sessions.erase(it);
+            return std::nullopt;
+        }
+        it->lastUse = ++m_uses;
+        return it->value;
+    }
+
+    /// Keeps @p value for the next query of @p client
+    void store(const void *client, Xapian::rev revision, T value)
+    {
+        if (!client) {
+            return;
+        }
+
+        QMutexLocker lock(&m_mutex);
+        // Sessions of older revisions can never be used again
+        m_sessions.removeIf([revision](const auto &it) {
+            return it.value().revision != revision;
+        });
+        if (m_sessions.size() >= MaxSessions && !m_sessions.contains(client)) {
+            const auto oldest = std::min_element(m_sessions.begin(), m_sessions.end(), [](const Session &a, const Session &b) {
+                return a.lastUse < b.lastUse;
+            });
+            m_sessions.erase(oldest);
+        }
+        m_sessions.insert(client, Session{revision, ++m_uses, std::move(value)});
+    }
+
+    /// Forgets the session of @p client, its input does not extend anymore
+    void remove(const void *client)
+    {
+        if (!client) {
+            return;
+        }
+
+        QMutexLocker lock(&m_mutex);
+        m_sessions.remove(client);
+    }
+
+private:
+    struct Session {
+        Xapian::rev revision = 0;
+        quint64 lastUse = 0;
+        T value;
+    };
+
+    // A few completion widgets and runners type at the same time at most
+    static constexpr qsizetype MaxSessions = 16;
+
+    QMutex m_mutex;
+    QHash<const void *, Session> m_sessions;
+    quint64 m_uses = 0;
+};
+}
+}
+}
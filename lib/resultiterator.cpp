@@ -24,6 +24,15 @@ ResultIterator::~ResultIterator() = default;
 
 bool ResultIterator::next()
 {
+    if (d->m_byId) {
+        if (d->m_firstElement) {
+            d->m_firstElement = false;
+        } else if (d->m_pos < d->m_ids.size()) {
+            ++d->m_pos;
+        }
+        return d->m_pos < d->m_ids.size();
+    }
+
     if (d->m_iter == d->m_end) {
         return false;
     }
@@ -41,5 +50,21 @@ bool ResultIterator::next()
 Akonadi::Item::Id ResultIterator::id()
 {
     // qDebug() << d->m_iter.get_rank() << d->m_iter.get_weight();
+    if (d->m_byId) {
+        return d->m_pos < d->m_ids.size() ? d->m_ids[d->m_pos] : -1;
+    }
     return *(d->m_iter);
 }
+
+ContactRecord ResultIterator::contactRecord() const
+{
+    if (d->m_firstElement || (d->m_byId ? d->m_pos >= d->m_ids.size() : d->m_iter == d->m_end)) {
+        return {};
+    }
+    try {
+        const std::string data = d->m_byId ? d->m_db.get_document(d->m_ids[d->m_pos]).get_data() : d->m_iter.get_document().get_data();
+        return ContactRecord::fromData(QByteArray(data.data(), data.size()));
+    } catch (const Xapian::Error &) {
+        return {};
+    }
+}
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include "contactrecord.h"
 #include "search_pim_export.h"
 
 #include <Akonadi/Item>
@@ -64,6 +65,15 @@ public:
      */
     bool next();
 
+    /*!
+     * \brief Returns the display data of the current contact.
+     *
+     * Only results of a ContactQuery carry one. The record is empty for
+     * other results and for contacts indexed by an older indexer, which
+     * then have to be fetched from Akonadi.
+     */
+    [[nodiscard]] ContactRecord contactRecord() const;
+
 private:
     friend class ContactQuery;
     friend class EmailQuery;
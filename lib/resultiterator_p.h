@@ -12,6 +12,8 @@
 
 #include "resultiterator.h"
 
+#include <vector>
+
 namespace Akonadi
 {
 namespace Search
@@ -29,10 +31,25 @@ public:
         m_firstElement = true;
     }
 
+    // Results already known by their ids, in ranking order
+    void init(const Xapian::Database &db, std::vector<Xapian::docid> ids)
+    {
+        m_db = db;
+        m_ids = std::move(ids);
+        m_byId = true;
+        m_pos = 0;
+        m_firstElement = true;
+    }
+
     Xapian::MSet m_mset;
     Xapian::MSetIterator m_iter;
     Xapian::MSetIterator m_end;
 
+    Xapian::Database m_db;
+    std::vector<Xapian::docid> m_ids;
+    std::size_t m_pos = 0;
+    bool m_byId = false;
+
     bool m_firstElement = false;
 };
 }
@@ -14,14 +14,8 @@
 
 #include <QDesktopServices>
 #include <QIcon>
-#include <QSharedPointer>
-#include <QThread>
-
-#include <Akonadi/ItemFetchJob>
-#include <Akonadi/ItemFetchScope>
-#include <Akonadi/Session>
-
-#include <KContacts/Addressee>
+#include <QImage>
+#include <QPixmap>
 
 #include <KSharedConfig>
 
@@ -29,12 +23,11 @@
 
 #include "lib/contactcompleter.h"
 #include "lib/contactquery.h"
+#include "lib/contactrecord.h"
 #include "lib/resultiterator.h"
 
 #include <array>
 
-Q_DECLARE_METATYPE(KContacts::Addressee *)
-
 using namespace Qt::Literals::StringLiterals;
 PIMContactsRunner::PIMContactsRunner(QObject *parent, const KPluginMetaData &metaData)
     : AbstractRunner(parent, metaData)
@@ -56,18 +49,7 @@ void PIMContactsRunner::match(RunnerContext &context)
     if (queryString.size() < 3) {
         return;
     }
-    mListEmails.clear();
-
-    queryContacts(context, queryString);
 
-    qCDebug(AKONADI_KRUNNER_LOG) << this << "MATCH: queryAutocompleter =" << mQueryAutocompleter;
-    if (mQueryAutocompleter) {
-        queryAutocompleter(context, queryString);
-    }
-}
-
-void PIMContactsRunner::queryContacts(RunnerContext &context, const QString &queryString)
-{
     Akonadi::Search::PIM::ContactQuery query;
     query.matchName(queryString);
     query.matchEmail(queryString);
@@ -75,54 +57,54 @@ void PIMContactsRunner::queryContacts(RunnerContext &context, const QString &que
     // Does not make sense to list more than 50 contacts on broad search terms
     query.setLimit(50);
 
-    // Accumulate the results so that we can fetch all in single Akonadi request
-    Akonadi::Search::PIM::ResultIterator iter = query.exec();
-    QList<Akonadi::Item::Id> results;
-    while (iter.next()) {
-        results.push_back(iter.id());
+    // Both lookups run in the thread pool at the same time, each on its own database handle.
+    // A newer query of this runner cancels them, we are not interested anymore then
+    QFuture<Akonadi::Search::PIM::ResultIterator> contacts = query.execAsync(&mContactQueryOwner);
+    QFuture<QStringList> completions;
+    qCDebug(AKONADI_KRUNNER_LOG) << this << "MATCH: queryAutocompleter =" << mQueryAutocompleter;
+    if (mQueryAutocompleter) {
+        completions = Akonadi::Search::PIM::ContactCompleter(queryString).completeAsync(&mCompletionOwner);
     }
 
-    qCDebug(AKONADI_KRUNNER_LOG) << "Query:" << queryString << ", results:" << results.count();
+    // Addressbook contacts come first, the same addresses are not autocompleted again
+    QSet<QString> listedEmails;
+    queryContacts(context, queryString, contacts, listedEmails);
 
-    if (results.isEmpty()) {
+    // Outdated matches must not wait for the autocompleter
+    if (!context.isValid()) {
+        completions.cancel();
         return;
     }
+    if (mQueryAutocompleter) {
+        queryAutocompleter(context, queryString, completions, listedEmails);
+    }
+}
 
-    // There can be multiple queries running at the same time, make sure we have
-    // a separate Session for each, otherwise things might explode
-    QScopedPointer<Akonadi::Session, QScopedPointerDeleteLater> session(
-        new Akonadi::Session("PIIMContactRunner-" + QByteArray::number((qlonglong)QThread::currentThread())));
-    auto fetch = new Akonadi::ItemFetchJob(results, session.data());
-    Akonadi::ItemFetchScope &scope = fetch->fetchScope();
-    scope.fetchFullPayload(true);
-    scope.setFetchRemoteIdentification(false);
-    scope.setAncestorRetrieval(Akonadi::ItemFetchScope::None);
-
-    if (!fetch->exec()) {
-        qCWarning(AKONADI_KRUNNER_LOG) << "Error while fetching contacts:" << fetch->errorString();
+void PIMContactsRunner::queryContacts(RunnerContext &context,
+                                      const QString &queryString,
+                                      QFuture<Akonadi::Search::PIM::ResultIterator> future,
+                                      QSet<QString> &listedEmails)
+{
+    future.waitForFinished();
+    if (future.isCanceled() || future.resultCount() == 0 || !context.isValid()) {
         return;
     }
 
-    const auto items = fetch->items();
-    for (const Akonadi::Item &item : items) {
-        KContacts::Addressee contact;
-        try {
-            contact = item.payload<KContacts::Addressee>();
-        } catch (const Akonadi::Exception &e) {
-            qCDebug(AKONADI_KRUNNER_LOG) << "Corrupted index? Index referrers to an Item without contact";
-            // Error?
-            continue;
-        }
-
+    // The index carries everything we display, no need to fetch the contacts
+    Akonadi::Search::PIM::ResultIterator iter = future.result();
+    int results = 0;
+    while (iter.next()) {
+        ++results;
+        const Akonadi::Search::PIM::ContactRecord contact = iter.contactRecord();
         if (contact.isEmpty()) {
-            qCDebug(AKONADI_KRUNNER_LOG) << "Corrupted index? Index refers to an Item with an empty contact";
+            qCDebug(AKONADI_KRUNNER_LOG) << "Contact" << iter.id() << "has no display data, the index needs to be rebuilt";
             continue;
         }
 
         const QStringList emails = contact.emails();
         if (emails.isEmpty()) {
             // No email, don't show the contact
-            qCDebug(AKONADI_KRUNNER_LOG) << "Skipping" << contact.uid() << ", because it has no emails";
+            qCDebug(AKONADI_KRUNNER_LOG) << "Skipping" << iter.id() << ", because it has no emails";
             continue;
         }
 
@@ -130,22 +112,17 @@ void PIMContactsRunner::queryContacts(RunnerContext &context, const QString &que
         match.setMatchCategory(i18n("Contacts"));
         match.setRelevance(0.75); // 0.75 is used by most runners, we don't
 
-        const KContacts::Picture photo = contact.photo();
-        if (!photo.isEmpty()) {
-            const QImage img = photo.data().scaled(16, 16, Qt::KeepAspectRatio);
+        const QImage img = QImage::fromData(contact.thumbnail());
+        if (!img.isNull()) {
             match.setIcon(QIcon(QPixmap::fromImage(img)));
         } else {
             // The icon should be cached by Qt or FrameworkIntegration
             match.setIcon(QIcon::fromTheme(u"user-identity"_s));
         }
 
+        const QString name = contact.name();
         QString matchedEmail;
 
-        QString name = contact.formattedName();
-        if (name.isEmpty()) {
-            name = contact.assembledName();
-        }
-
         // We got perfect match by name
         if (name == queryString) {
             match.setCategoryRelevance(QueryMatch::CategoryRelevance::Highest);
@@ -170,16 +147,16 @@ void PIMContactsRunner::queryContacts(RunnerContext &context, const QString &que
         // If we had an email match, then use it, otherwise assume name-based
         // match and explode the contact to all available email addresses
         if (!matchedEmail.isEmpty()) {
-            if (!mListEmails.contains(matchedEmail)) {
-                mListEmails.append(matchedEmail);
+            if (!listedEmails.contains(matchedEmail)) {
+                listedEmails.insert(matchedEmail);
                 match.setText(i18nc("Name (email)", "%1 (%2)", name, matchedEmail));
                 match.setData(u"mailto:%1"_s.arg(matchedEmail));
                 context.addMatch(match);
             }
         } else {
             for (const QString &email : emails) {
-                if (!mListEmails.contains(email)) {
-                    mListEmails.append(email);
+                if (!listedEmails.contains(email)) {
+                    listedEmails.insert(email);
                     QueryMatch alternativeMatch = match;
                     alternativeMatch.setText(i18nc("Name (email)", "%1 (%2)", name, email));
                     alternativeMatch.setData(u"mailto:%1"_s.arg(email));
@@ -188,12 +165,17 @@ void PIMContactsRunner::queryContacts(RunnerContext &context, const QString &que
             }
         }
     }
+
+    qCDebug(AKONADI_KRUNNER_LOG) << "Query:" << queryString << ", results:" << results;
 }
 
-void PIMContactsRunner::queryAutocompleter(RunnerContext &context, const QString &queryString)
+void PIMContactsRunner::queryAutocompleter(RunnerContext &context, const QString &queryString, QFuture<QStringList> future, QSet<QString> &listedEmails)
 {
-    Akonadi::Search::PIM::ContactCompleter completer(queryString);
-    const QStringList completerResults = completer.complete();
+    future.waitForFinished();
+    if (future.isCanceled() || future.resultCount() == 0 || !context.isValid()) {
+        return;
+    }
+    const QStringList completerResults = future.result();
     qCDebug(AKONADI_KRUNNER_LOG) << "Autocompleter returned" << completerResults.count() << "results";
     for (const QString &result : completerResults) {
         // Filter out results where writing a mail wouldn't make sense,
@@ -230,10 +212,10 @@ void PIMContactsRunner::queryAutocompleter(RunnerContext &context, const QString
         QString name;
         QString email;
         if (KEmailAddress::extractEmailAddressAndName(result, email, name)) {
-            if (mListEmails.contains(email)) {
+            if (listedEmails.contains(email)) {
                 continue;
             }
-            mListEmails.append(email);
+            listedEmails.insert(email);
             if (name.isEmpty()) {
                 match.setText(email);
                 match.setData(u"mailto:%1"_s.arg(email));
@@ -242,10 +224,10 @@ void PIMContactsRunner::queryAutocompleter(RunnerContext &context, const QString
                 match.setData(u"mailto:%1"_s.arg(email));
             }
         } else {
-            if (mListEmails.contains(result)) {
+            if (listedEmails.contains(result)) {
                 continue;
             }
-            mListEmails.append(result);
+            listedEmails.insert(result);
             match.setText(result);
             match.setData(u"mailto:%1"_s.arg(result));
         }
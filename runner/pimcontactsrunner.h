@@ -9,6 +9,11 @@
 
 #include <KRunner/AbstractRunner>
 
+#include <QFuture>
+#include <QSet>
+
+#include "lib/resultiterator.h"
+
 using namespace KRunner;
 class PIMContactsRunner : public KRunner::AbstractRunner
 {
@@ -24,10 +29,15 @@ public:
     void run(const RunnerContext &context, const QueryMatch &match) override;
 
 private:
-    void queryContacts(RunnerContext &context, const QString &queryString);
-    void queryAutocompleter(RunnerContext &context, const QString &queryString);
+    void queryContacts(RunnerContext &context,
+                       const QString &queryString,
+                       QFuture<Akonadi::Search::PIM::ResultIterator> future,
+                       QSet<QString> &listedEmails);
+    void queryAutocompleter(RunnerContext &context, const QString &queryString, QFuture<QStringList> future, QSet<QString> &listedEmails);
 
 private:
     bool mQueryAutocompleter = true;
-    QStringList mListEmails;
+    // Starting a query cancels the previous one with the same owner
+    const char mContactQueryOwner = 0;
+    const char mCompletionOwner = 0;
 };
@@ -22,6 +22,11 @@ CalendarSearchStore::CalendarSearchStore(QObject *parent)
 
     m_boolWithValue << u"partstatus"_s;
 
+    // Collections with their subfolders, and resources
+    m_prefix.insert(u"subtree"_s, u"XCA:"_s);
+    m_prefix.insert(u"resource"_s, u"XCR:"_s);
+    m_boolWithValue << u"subtree"_s << u"resource"_s;
+
     setDbPath(findDatabase(u"calendars"_s));
 }
 
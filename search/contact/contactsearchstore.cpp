@@ -20,6 +20,11 @@ ContactSearchStore::ContactSearchStore(QObject *parent)
     m_prefix.insert(u"collection"_s, u"C"_s);
     m_prefix.insert(u"uid"_s, u"UID"_s);
 
+    // Collections with their subfolders, and resources
+    m_prefix.insert(u"subtree"_s, u"XCA:"_s);
+    m_prefix.insert(u"resource"_s, u"XCR:"_s);
+    m_boolWithValue << u"subtree"_s << u"resource"_s;
+
     m_valueProperties.insert(u"birthday"_s, 0);
     m_valueProperties.insert(u"anniversary"_s, 1);
 
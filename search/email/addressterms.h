@@ -0,0 +1,121 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+
+#include <string>
+#include <string_view>
+
+namespace Akonadi
+{
+namespace Search
+{
+/**
+ * The structured address terms of an address field.
+ *
+ * The email indexer adds one term of each kind per address, named
+ * "<kind prefix><field prefix>:<value>", "XDF:example.org" for the domain of
+ * a sender. Values are in lower case. Followed by a field, the kind prefixes
+ * must not give another prefix of the email index, like "XRF:" of References.
+ */
+enum class AddressTermKind {
+    Address,
+    LocalPart,
+    Domain,
+    RegistrableDomain,
+};
+
+inline const char *addressTermPrefix(AddressTermKind kind)
+{
+    switch (kind) {
+    case AddressTermKind::Address:
+        return "XA";
+    case AddressTermKind::LocalPart:
+        return "XU";
+    case AddressTermKind::Domain:
+        return "XD";
+    case AddressTermKind::RegistrableDomain:
+        return "XO";
+    }
+    return "";
+}
+
+/// Appended to a field to name its search store property, "fromdomain" for "from"
+inline QLatin1StringView addressPropertySuffix(AddressTermKind kind)
+{
+    switch (kind) {
+    case AddressTermKind::Address:
+        return QLatin1StringView("address");
+    case AddressTermKind::LocalPart:
+        return QLatin1StringView("localpart");
+    case AddressTermKind::Domain:
+        return QLatin1StringView("domain");
+    case AddressTermKind::RegistrableDomain:
+        return QLatin1StringView("registrabledomain");
+    }
+    return {};
+}
+
+inline std::string addressTerm(AddressTermKind kind, std::string_view field, std::string_view value)
+{
+    std::string term(addressTermPrefix(kind));
+    term.append(field);
+    term.push_back(':');
+    term.append(value);
+    return term;
+}
+
+/**
+ * An exact address filter typed by the user.
+ *
+ * Domains ("@example.org" or "*@example.org") match the domain and the
+ * registrable domain terms, complete addresses the address terms. Anything
+ * else is no filter and should go through the query parser.
+ */
+struct AddressFilter {
+    /// The kinds of terms to look for, any of them matches
+    QList<AddressTermKind> kinds;
+    /// The domain or address, in lower case
+    QString value;
+
+    [[nodiscard]] bool isValid() const
+    {
+        return !kinds.isEmpty();
+    }
+
+    [[nodiscard]] bool isDomain() const
+    {
+        return kinds.contains(AddressTermKind::Domain);
+    }
+
+    [[nodiscard]] static AddressFilter parse(const QString &str)
+    {
+        AddressFilter filter;
+        const QString value = str.trimmed().toLower();
+        if (value.startsWith(u'@') || value.startsWith(QLatin1StringView("*@"))) {
+            filter.value = value.mid(value.indexOf(u'@') + 1);
+            if (!filter.value.isEmpty()) {
+                filter.kinds = {AddressTermKind::Domain, AddressTermKind::RegistrableDomain};
+            }
+            return filter;
+        }
+
+        static const QRegularExpression plainAddress(QStringLiteral("^[^@\\s<>\"]+@[^@\\s<>\"]+$"));
+        if (plainAddress.match(value).hasMatch()) {
+            filter.value = value;
+            filter.kinds = {AddressTermKind::Address};
+        }
+        return filter;
+    }
+};
+}
+}
@@ -9,53 +9,53 @@
 #include "agepostingsource.h"
 
 #include <QDateTime>
-#include <QString>
 
+#include <algorithm>
 #include <chrono>
 
 using namespace Akonadi::Search;
-using namespace Qt::Literals::StringLiterals;
+
+namespace
+{
+constexpr double maxWeight = 1000.0;
+// Each day is given a penalty of 1.0
+constexpr double penaltyPerSecond = 1.0 / std::chrono::duration_cast<std::chrono::seconds>(std::chrono::hours(24)).count();
+}
+
 AgePostingSource::AgePostingSource(Xapian::valueno slot_)
+    : AgePostingSource(slot_, static_cast<double>(QDateTime::currentSecsSinceEpoch()))
+{
+}
+
+AgePostingSource::AgePostingSource(Xapian::valueno slot_, double currentTime)
     : Xapian::ValuePostingSource(slot_)
-    , m_currentTime_t(QDateTime::currentSecsSinceEpoch())
+    , m_currentTime(currentTime)
 {
 }
 
 double AgePostingSource::get_weight() const
 {
-    using namespace std::chrono;
-    constexpr auto secondsInDay = duration_cast<seconds>(hours(24)).count();
-
-    const QString str = QString::fromStdString(get_value());
-
-    bool ok = false;
-    const uint time = str.toUInt(&ok);
-
-    if (!ok) {
+    // Short enough for the small string optimization, no allocation here
+    const std::string value = get_value();
+    if (value.empty()) {
         return 0.0;
     }
 
-    const uint diff = m_currentTime_t - time;
-
-    // Each day is given a penalty of penalty of 1.0
-
-    const double penalty = 1.0 / secondsInDay;
-    const double result = 1000.0 - (diff * penalty);
-
+    const double result = maxWeight - (m_currentTime - Xapian::sortable_unserialise(value)) * penaltyPerSecond;
     if (result < 0.0) {
         return 0.0;
     }
-
-    return result;
+    // Messages from the future do not get a bonus
+    return std::min(result, maxWeight);
 }
 
 Xapian::PostingSource *AgePostingSource::clone() const
 {
-    return new AgePostingSource(get_slot());
+    return new AgePostingSource(get_slot(), m_currentTime);
 }
 
 void AgePostingSource::init(const Xapian::Database &db_)
 {
     Xapian::ValuePostingSource::init(db_);
-    set_maxweight(1000.0);
+    set_maxweight(maxWeight);
 }
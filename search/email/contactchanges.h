@@ -0,0 +1,60 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <xapian.h>
+
+#include <QtEndian>
+
+#include <string>
+#include <vector>
+
+namespace Akonadi
+{
+namespace Search
+{
+/**
+ * The contacts of the emailContacts database changed by its last commits.
+ *
+ * Before committing, the email indexer stores the ids of the contacts it
+ * added, changed or deleted under contactChangesKey() of the revision the
+ * commit creates. Only the last MaxContactChangeRevisions are kept, so
+ * readers can catch up with a recent revision without reading every
+ * contact, and read everything again otherwise.
+ */
+constexpr Xapian::rev MaxContactChangeRevisions = 64;
+
+inline std::string contactChangesKey(Xapian::rev revision)
+{
+    return "contactchanges:" + std::to_string(revision);
+}
+
+/// Contact ids as big endian integers, after a marker so that no change list is empty
+inline std::string serializeContactIds(const std::vector<Xapian::docid> &ids)
+{
+    std::string data(1, 'c');
+    data.reserve(1 + ids.size() * 4);
+    for (const Xapian::docid id : ids) {
+        char bytes[4];
+        qToBigEndian<quint32>(id, bytes);
+        data.append(bytes, 4);
+    }
+    return data;
+}
+
+inline std::vector<Xapian::docid> deserializeContactIds(const std::string &data)
+{
+    std::vector<Xapian::docid> ids;
+    for (std::size_t pos = 1; pos + 4 <= data.size(); pos += 4) {
+        ids.push_back(qFromBigEndian<quint32>(data.data() + pos));
+    }
+    return ids;
+}
+}
+}
@@ -9,6 +9,7 @@
 #include "emailsearchstore.h"
 using namespace Qt::Literals::StringLiterals;
 
+#include "addressterms.h"
 #include "agepostingsource.h"
 #include "query.h"
 #include "term.h"
@@ -35,8 +36,47 @@ EmailSearchStore::EmailSearchStore(QObject *parent)
     m_prefix.insert(u"body"_s, u"BO"_s);
     m_prefix.insert(u"headers"_s, u"HE"_s);
 
+    // Attachments, their text is only there once extracted
+    m_prefix.insert(u"attachmentname"_s, u"AN"_s);
+    m_prefix.insert(u"attachment"_s, u"AT"_s);
+    m_prefix.insert(u"attachmenttype"_s, u"AM"_s);
+    m_boolWithValue << u"attachmenttype"_s;
+
+    // Thread structure, "thread" finds all messages in the thread of a Message-ID
+    m_prefix.insert(u"messageid"_s, u"XMI:"_s);
+    m_prefix.insert(u"inreplyto"_s, u"XIR:"_s);
+    m_prefix.insert(u"references"_s, u"XRF:"_s);
+    m_prefix.insert(u"threadroot"_s, u"XTR:"_s);
+    m_prefix.insert(u"thread"_s, u"XTR:"_s);
+
+    // Structured address terms, exact values in lower case
+    const std::pair<QString, QString> addressFields[] = {
+        {u"from"_s, u"F"_s},
+        {u"to"_s, u"T"_s},
+        {u"cc"_s, u"CC"_s},
+        {u"bcc"_s, u"BC"_s},
+        {u"replyto"_s, u"RT"_s},
+    };
+    for (const auto &[field, prefix] : addressFields) {
+        for (const AddressTermKind kind :
+             {AddressTermKind::Address, AddressTermKind::LocalPart, AddressTermKind::Domain, AddressTermKind::RegistrableDomain}) {
+            const QString property = field + addressPropertySuffix(kind);
+            m_prefix.insert(property, QString::fromStdString(addressTerm(kind, prefix.toStdString(), {})));
+            m_boolWithValue << property;
+            m_lowerCaseProperties << property;
+        }
+    }
+
     // TODO: Add body flag?
-    // TODO: Add tags?
+
+    // Tags, by id
+    m_prefix.insert(u"tag"_s, u"XTG:"_s);
+    m_boolWithValue << u"tag"_s;
+
+    // Collections with their subfolders, and resources
+    m_prefix.insert(u"subtree"_s, u"XCA:"_s);
+    m_prefix.insert(u"resource"_s, u"XCR:"_s);
+    m_boolWithValue << u"subtree"_s << u"resource"_s;
 
     // Boolean Flags
     m_prefix.insert(u"isimportant"_s, u"I"_s);
@@ -73,6 +113,14 @@ QStringList EmailSearchStore::types()
 
 Xapian::Query EmailSearchStore::constructQuery(const QString &property, const QVariant &value, Term::Comparator com)
 {
+    const QString prop = property.toLower();
+    if (prop == "messageid"_L1 || prop == "inreplyto"_L1 || prop == "references"_L1 || prop == "threadroot"_L1) {
+        return Xapian::Query(m_prefix.value(prop).toStdString() + messageIdentifier(value.toString()));
+    }
+    if (prop == "thread"_L1) {
+        return threadQuery(messageIdentifier(value.toString()));
+    }
+
     // TODO is this special case necessary? maybe we can also move it to PIM
     if (com == Term::Contains) {
         if (!m_prefix.contains(property.toLower())) {
@@ -82,11 +130,42 @@ Xapian::Query EmailSearchStore::constructQuery(const QString &property, const QV
     return PIMSearchStore::constructQuery(property, value, com);
 }
 
+std::string EmailSearchStore::messageIdentifier(const QString &messageId)
+{
+    QString id = messageId.trimmed();
+    if (id.startsWith(u'<') && id.endsWith(u'>')) {
+        id = id.mid(1, id.size() - 2);
+    }
+    return id.toStdString();
+}
+
+Xapian::Query EmailSearchStore::threadQuery(const std::string &messageId)
+{
+    // Look up the thread root of the message, if it is indexed
+    std::string root = messageId;
+    Xapian::Database *db = xapianDb();
+    const std::string idTerm = "XMI:" + messageId;
+    const Xapian::PostingIterator postIt = db->postlist_begin(idTerm);
+    if (postIt != db->postlist_end(idTerm)) {
+        Xapian::TermIterator it = db->termlist_begin(*postIt);
+        it.skip_to("XTR:");
+        if (it != db->termlist_end(*postIt) && (*it).compare(0, 4, "XTR:") == 0) {
+            root = (*it).substr(4);
+        }
+    }
+
+    const Xapian::Query queries[] = {
+        Xapian::Query("XTR:" + root),
+        Xapian::Query("XRF:" + root),
+        Xapian::Query("XMI:" + root),
+    };
+    return Xapian::Query(Xapian::Query::OP_OR, std::begin(queries), std::end(queries));
+}
+
 QString EmailSearchStore::text(int queryId)
 {
     Xapian::Document doc = docForQuery(queryId);
 
-    QMutexLocker lock(&m_mutex);
     std::string data;
     try {
         data = doc.get_data();
@@ -104,7 +183,7 @@ QString EmailSearchStore::text(int queryId)
 
 Xapian::Query EmailSearchStore::finalizeQuery(const Xapian::Query &query)
 {
-    return Xapian::Query(Xapian::Query::OP_AND_MAYBE, query, Xapian::Query(new AgePostingSource(0)));
+    return Xapian::Query(Xapian::Query::OP_AND_MAYBE, query, Xapian::Query((new AgePostingSource(0))->release()));
 }
 
 #include "moc_emailsearchstore.cpp"
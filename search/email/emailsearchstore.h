@@ -35,6 +35,10 @@ public:
 protected:
     Xapian::Query constructQuery(const QString &property, const QVariant &value, Term::Comparator com) override;
     Xapian::Query finalizeQuery(const Xapian::Query &query) override;
+
+private:
+    [[nodiscard]] static std::string messageIdentifier(const QString &messageId);
+    [[nodiscard]] Xapian::Query threadQuery(const std::string &messageId);
 };
 }
 }
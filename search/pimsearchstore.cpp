@@ -11,6 +11,7 @@ using namespace Qt::Literals::StringLiterals;
 
 #include "query.h"
 #include "term.h"
+#include "xapiantermgenerator.h"
 
 #include <Akonadi/ServerManager>
 #include <QDir>
@@ -18,8 +19,216 @@ using namespace Qt::Literals::StringLiterals;
 
 #include <QUrlQuery>
 
+#include <algorithm>
+
 using namespace Akonadi::Search;
 
+namespace
+{
+// Replaces the phrases of a query by the bigram terms added by the indexer
+Xapian::Query rewritePhrases(const Xapian::Query &query, const std::string &prefix)
+{
+    const Xapian::Query::op type = query.get_type();
+    const std::size_t count = query.get_num_subqueries();
+    if (type == Xapian::Query::OP_PHRASE) {
+        std::string words;
+        for (std::size_t i = 0; i < count; ++i) {
+            const Xapian::Query sub = query.get_subquery(i);
+            if (sub.get_type() != Xapian::Query::LEAF_TERM) {
+                return query;
+            }
+            const std::string term = *sub.get_terms_begin();
+            words += std::string_view(term).substr(term.compare(0, prefix.size(), prefix) == 0 ? prefix.size() : 0);
+            words += ' ';
+        }
+        const std::vector<std::string> bigrams = XapianTermGenerator::bigramTerms(words, prefix);
+        if (bigrams.empty()) {
+            return query;
+        }
+        return Xapian::Query(Xapian::Query::OP_AND, bigrams.cbegin(), bigrams.cend());
+    }
+
+    switch (type) {
+    case Xapian::Query::OP_AND:
+    case Xapian::Query::OP_OR:
+    case Xapian::Query::OP_AND_NOT:
+    case Xapian::Query::OP_XOR:
+    case Xapian::Query::OP_AND_MAYBE:
+    case Xapian::Query::OP_FILTER:
+        break;
+    default:
+        return query;
+    }
+
+    std::vector<Xapian::Query> subqueries;
+    subqueries.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        subqueries.push_back(rewritePhrases(query.get_subquery(i), prefix));
+    }
+    return Xapian::Query(type, subqueries.cbegin(), subqueries.cend());
+}
+
+// Matches the documents with a term of the prefix containing the needle. The
+// trigram postings of the needle are intersected, and the candidates verified
+// against their terms.
+class SubstringPostingSource : public Xapian::PostingSource
+{
+public:
+    SubstringPostingSource(const std::string &prefix, const std::string &needle)
+        : m_prefix(prefix)
+        , m_needle(needle)
+        , m_trigrams(XapianTermGenerator::trigramTerms(needle, prefix))
+    {
+    }
+
+    Xapian::PostingSource *clone() const override
+    {
+        return new SubstringPostingSource(m_prefix, m_needle);
+    }
+
+    std::string name() const override
+    {
+        return "SubstringPostingSource";
+    }
+
+    void init(const Xapian::Database &db) override
+    {
+        m_db = db;
+        m_lists.clear();
+        m_started = false;
+        m_atEnd = m_trigrams.empty();
+
+        Xapian::doccount termFreq = db.get_doccount();
+        for (const std::string &trigram : m_trigrams) {
+            m_lists.push_back({db.postlist_begin(trigram), db.postlist_end(trigram), db.get_termfreq(trigram)});
+            termFreq = std::min(termFreq, m_lists.back().termFreq);
+        }
+        // Drive the intersection from the rarest trigram
+        std::sort(m_lists.begin(), m_lists.end(), [](const PostList &a, const PostList &b) {
+            return a.termFreq < b.termFreq;
+        });
+        if (termFreq == 0) {
+            m_atEnd = true;
+        }
+
+        set_maxweight(0);
+        m_termFreqMax = termFreq;
+    }
+
+    Xapian::doccount get_termfreq_min() const override
+    {
+        return 0;
+    }
+
+    Xapian::doccount get_termfreq_est() const override
+    {
+        return m_termFreqMax / 2;
+    }
+
+    Xapian::doccount get_termfreq_max() const override
+    {
+        return m_termFreqMax;
+    }
+
+    void next(double /*minWeight*/) override
+    {
+        if (m_atEnd) {
+            return;
+        }
+        if (m_started) {
+            ++m_lists.front().it;
+        }
+        m_started = true;
+        settle();
+    }
+
+    void skip_to(Xapian::docid did, double /*minWeight*/) override
+    {
+        if (m_atEnd) {
+            return;
+        }
+        m_started = true;
+        m_lists.front().it.skip_to(did);
+        settle();
+    }
+
+    bool at_end() const override
+    {
+        return m_atEnd;
+    }
+
+    Xapian::docid get_docid() const override
+    {
+        return *m_lists.front().it;
+    }
+
+private:
+    struct PostList {
+        Xapian::PostingIterator it;
+        Xapian::PostingIterator end;
+        Xapian::doccount termFreq;
+    };
+
+    // Moves to the next document having all trigrams and a matching term
+    void settle()
+    {
+        PostList &driver = m_lists.front();
+        while (driver.it != driver.end) {
+            const Xapian::docid did = *driver.it;
+            Xapian::docid next = did;
+            for (std::size_t i = 1; i < m_lists.size(); ++i) {
+                PostList &list = m_lists[i];
+                list.it.skip_to(did);
+                if (list.it == list.end) {
+                    m_atEnd = true;
+                    return;
+                }
+                if (*list.it != did) {
+                    next = *list.it;
+                    break;
+                }
+            }
+
+            if (next != did) {
+                driver.it.skip_to(next);
+            } else if (verify(did)) {
+                return;
+            } else {
+                ++driver.it;
+            }
+        }
+        m_atEnd = true;
+    }
+
+    bool verify(Xapian::docid did) const
+    {
+        auto it = m_db.termlist_begin(did);
+        const auto end = m_db.termlist_end(did);
+        for (it.skip_to(m_prefix); it != end; ++it) {
+            const std::string term = *it;
+            if (term.compare(0, m_prefix.size(), m_prefix) != 0) {
+                break;
+            }
+            // Needles are lowercase, terms may be raw-case addresses
+            if (Xapian::Unicode::tolower(term.substr(m_prefix.size())).find(m_needle) != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::string m_prefix;
+    const std::string m_needle;
+    const std::vector<std::string> m_trigrams;
+
+    Xapian::Database m_db;
+    std::vector<PostList> m_lists;
+    Xapian::doccount m_termFreqMax = 0;
+    bool m_started = false;
+    bool m_atEnd = true;
+};
+}
+
 PIMSearchStore::PIMSearchStore(QObject *parent)
     : XapianSearchStore(parent)
 {
@@ -90,9 +299,24 @@ Xapian::Query PIMSearchStore::constructQuery(const QString &property, const QVar
         return Xapian::Query(term);
     }
 
+    // The plugin lists the subtree root first, then the collections below it
+    if (prop == "subtree"_L1 && value.userType() == QMetaType::QStringList) {
+        const QStringList collections = value.toStringList();
+        if (collections.isEmpty()) {
+            return {};
+        }
+        QList<qint64> members;
+        members.reserve(collections.size() - 1);
+        for (qsizetype i = 1; i < collections.size(); ++i) {
+            members << collections.at(i).toLongLong();
+        }
+        return m_subtreeQueries.query(*xapianDb(), collections.constFirst().toLongLong(), members);
+    }
+
     if (m_boolWithValue.contains(prop)) {
         std::string term(m_prefix.value(prop).toStdString());
-        std::string val(value.toString().toStdString());
+        const QString str = m_lowerCaseProperties.contains(prop) ? value.toString().trimmed().toLower() : value.toString();
+        std::string val(str.toStdString());
         return Xapian::Query(term + val);
     }
 
@@ -106,14 +330,14 @@ Xapian::Query PIMSearchStore::constructQuery(const QString &property, const QVar
             --numVal;
         }
         int valueNumber = m_valueProperties.value(prop);
+        // The indexers store numbers with sortable_serialise()
+        const std::string serialisedVal = Xapian::sortable_serialise(numVal);
         if (com == Term::GreaterEqual || com == Term::Greater) {
-            return Xapian::Query(Xapian::Query::OP_VALUE_GE, valueNumber, QString::number(numVal).toStdString());
+            return Xapian::Query(Xapian::Query::OP_VALUE_GE, valueNumber, serialisedVal);
         } else if (com == Term::LessEqual || com == Term::Less) {
-            return Xapian::Query(Xapian::Query::OP_VALUE_LE, valueNumber, QString::number(numVal).toStdString());
+            return Xapian::Query(Xapian::Query::OP_VALUE_LE, valueNumber, serialisedVal);
         } else if (com == Term::Equal) {
-            const Xapian::Query gtQuery(Xapian::Query::OP_VALUE_GE, valueNumber, QString::number(numVal).toStdString());
-            const Xapian::Query ltQuery(Xapian::Query::OP_VALUE_LE, valueNumber, QString::number(numVal).toStdString());
-            return Xapian::Query(Xapian::Query::OP_AND, gtQuery, ltQuery);
+            return Xapian::Query(Xapian::Query::OP_VALUE_RANGE, valueNumber, serialisedVal, serialisedVal);
         }
     } else if ((com == Term::Contains || com == Term::Equal) && m_prefix.contains(prop)) {
         Xapian::QueryParser parser;
@@ -121,21 +345,42 @@ Xapian::Query PIMSearchStore::constructQuery(const QString &property, const QVar
 
         std::string p = m_prefix.value(prop).toStdString();
         std::string str(value.toString().toStdString());
+        // Phrases can be matched with bigram terms, where the indexer added them
+        const bool useBigrams = !xapianDb()->has_positions() && hasPrefixMetadata(XapianTermGenerator::bigramMetadataKey, p);
         int flags = Xapian::QueryParser::FLAG_DEFAULT;
         if (com == Term::Contains) {
             flags |= Xapian::QueryParser::FLAG_PARTIAL;
             // Get same behaviour between Xapian 1.4 and 2.0 as index_without_position was ignored in 1.4 if db had no position by default.
             // This is not anymore the case by default with Xapian 2.0.
-            // Note that toto@titi.com (both with versions 1.4 and 2.0) will match titi.com@toto for instance, as it's not positioned.
-            if (!xapianDb()->has_positions()) {
+            // Note that without bigrams toto@titi.com (both with versions 1.4 and 2.0) will match titi.com@toto for instance, as it's not positioned.
+            if (!xapianDb()->has_positions() && !useBigrams) {
                 flags |= Xapian::QueryParser::FLAG_NO_POSITIONS;
             }
         }
-        return parser.parse_query(str, flags, p);
+        Xapian::Query query = parser.parse_query(str, flags, p);
+        if (useBigrams) {
+            query = rewritePhrases(query, p);
+        }
+
+        // Also find words containing the value, where the indexer added trigrams
+        if (com == Term::Contains && hasPrefixMetadata(XapianTermGenerator::trigramMetadataKey, p)) {
+            const QString needle = value.toString().trimmed().toLower();
+            if (needle.size() >= 3 && !needle.contains(u' ')) {
+                auto source = new SubstringPostingSource(p, needle.toStdString());
+                query = Xapian::Query(Xapian::Query::OP_OR, query, Xapian::Query(source->release()));
+            }
+        }
+        return query;
     }
     return Xapian::Query(value.toString().toStdString());
 }
 
+bool PIMSearchStore::hasPrefixMetadata(const char *key, const std::string &prefix)
+{
+    const QByteArray prefixes = QByteArray::fromStdString(xapianDb()->get_metadata(key));
+    return !prefix.empty() && prefixes.split(',').contains(QByteArray::fromStdString(prefix));
+}
+
 QUrl PIMSearchStore::constructUrl(const Xapian::docid &docid)
 {
     QUrl url;
@@ -148,4 +393,13 @@ QUrl PIMSearchStore::constructUrl(const Xapian::docid &docid)
     return url;
 }
 
+Xapian::valueno PIMSearchStore::sortingValue(const QString &property)
+{
+    const auto it = m_valueProperties.constFind(property);
+    if (it == m_valueProperties.cend()) {
+        return Xapian::BAD_VALUENO;
+    }
+    return static_cast<Xapian::valueno>(*it);
+}
+
 #include "moc_pimsearchstore.cpp"
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "subtreequery.h"
 #include "xapiansearchstore.h"
 
 #include <QSet>
@@ -40,6 +41,10 @@ protected:
 
     Xapian::Query constructQuery(const QString &property, const QVariant &value, Term::Comparator com) override;
     QUrl constructUrl(const Xapian::docid &docid) override;
+    Xapian::valueno sortingValue(const QString &property) override;
+
+    /// Whether every document has the extra terms listed under \a key for the given prefix
+    [[nodiscard]] bool hasPrefixMetadata(const char *key, const std::string &prefix);
 
     QHash<QString, QString> m_prefix;
 
@@ -54,7 +59,14 @@ protected:
      */
     QSet<QString> m_boolWithValue;
 
+    /* Properties of m_boolWithValue whose values are indexed in lower case
+     */
+    QSet<QString> m_lowerCaseProperties;
+
     QHash<QString, int> m_valueProperties;
+
+private:
+    SubtreeQueries m_subtreeQueries;
 };
 }
 }
@@ -0,0 +1,92 @@
+/*
+ * This file is part of the KDE Akonadi Search Project
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+ *
+ */
+
+#pragma once
+
+#include <xapian.h>
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+#include <string>
+#include <vector>
+
+namespace Akonadi
+{
+namespace Search
+{
+/**
+ * Matches the items of a subtree root and of the listed members below it.
+ *
+ * The "XCA:<root>" subtree term is enough when no item below the root is in
+ * another folder, one the collection index didn't know when the members were
+ * listed. Otherwise every listed folder gets its "C" term.
+ *
+ * Checking that costs a match, so its outcome is kept until the item index
+ * changes. Thread safe.
+ */
+class SubtreeQueries
+{
+public:
+    Xapian::Query query(const Xapian::Database &db, qint64 root, const QList<qint64> &members)
+    {
+        const Xapian::Query subtree("XCA:" + std::to_string(root));
+
+        std::vector<std::string> terms;
+        terms.reserve(members.size() + 1);
+        terms.push_back('C' + std::to_string(root));
+        for (const qint64 id : members) {
+            terms.push_back('C' + std::to_string(id));
+        }
+        const Xapian::Query listed(Xapian::Query::OP_OR, terms.cbegin(), terms.cend());
+
+        QList<qint64> key{root};
+        key << members;
+        const std::string uuid = db.get_uuid();
+        const Xapian::rev revision = db.get_revision();
+        {
+            QMutexLocker locker(&m_mutex);
+            if (uuid != m_uuid || revision != m_revision) {
+                m_uuid = uuid;
+                m_revision = revision;
+                m_subtreeComplete.clear();
+            }
+            const auto it = m_subtreeComplete.constFind(key);
+            if (it != m_subtreeComplete.cend()) {
+                return *it ? subtree : listed;
+            }
+        }
+
+        Xapian::Enquire enquire(db);
+        enquire.set_query(Xapian::Query(Xapian::Query::OP_AND_NOT, subtree, listed));
+        enquire.set_weighting_scheme(Xapian::BoolWeight());
+        enquire.set_docid_order(Xapian::Enquire::ASCENDING);
+        const bool complete = enquire.get_mset(0, 1).empty();
+
+        QMutexLocker locker(&m_mutex);
+        if (uuid == m_uuid && revision == m_revision) {
+            if (m_subtreeComplete.size() >= MaxCachedSubtrees) {
+                m_subtreeComplete.clear();
+            }
+            m_subtreeComplete.insert(key, complete);
+        }
+        return complete ? subtree : listed;
+    }
+
+private:
+    static constexpr qsizetype MaxCachedSubtrees = 256;
+
+    QMutex m_mutex;
+    std::string m_uuid;
+    Xapian::rev m_revision = 0;
+    // Whether the subtree term of the root, the first id, matches the listed collections only
+    QHash<QList<qint64>, bool> m_subtreeComplete;
+};
+}
+}
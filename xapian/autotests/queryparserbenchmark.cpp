@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#include "queryparserbenchmark.h"
+using namespace Qt::Literals::StringLiterals;
+
+#include "../xapiandatabase.h"
+#include "../xapianqueryparser.h"
+
+#include <QElapsedTimer>
+#include <QTest>
+
+using namespace Akonadi::Search;
+
+// Five letter words, "aaaaa" to "acvzb"
+static constexpr int termCount = 50000;
+static constexpr int docCount = 20;
+
+static std::string word(int i)
+{
+    std::string str(5, 'a');
+    for (int pos = 4; pos >= 0; --pos) {
+        str[pos] = static_cast<char>('a' + i % 26);
+        i /= 26;
+    }
+    return str;
+}
+
+QueryParserBenchmark::QueryParserBenchmark() = default;
+
+QueryParserBenchmark::~QueryParserBenchmark() = default;
+
+void QueryParserBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_db = std::make_unique<XapianDatabase>(m_dir.path(), false);
+
+    // Term i is in (i % docCount) + 1 documents, so the frequencies differ
+    for (int doc = 1; doc <= docCount; ++doc) {
+        Xapian::Document document;
+        for (int i = 0; i < termCount; ++i) {
+            if (i % docCount >= doc - 1) {
+                document.add_term(word(i));
+            }
+        }
+        m_db->replaceDocument(doc, document);
+    }
+    m_db->commit();
+}
+
+void QueryParserBenchmark::testExpansionIsCapped()
+{
+    XapianQueryParser parser;
+    parser.setDatabase(m_db->db());
+
+    const Xapian::Query query = parser.expandWord(u"a"_s);
+    QCOMPARE(query.get_type(), Xapian::Query::OP_SYNONYM);
+    QCOMPARE(query.get_num_subqueries(), std::size_t(100));
+
+    // The most frequent terms are kept
+    const auto first = query.get_subquery(0).get_terms_begin();
+    QCOMPARE(m_db->db()->get_termfreq(*first), Xapian::doccount(docCount));
+}
+
+void QueryParserBenchmark::testExpansionFollowsCommits()
+{
+    XapianQueryParser parser;
+    parser.setDatabase(m_db->db());
+    QCOMPARE(parser.expandWord(u"zz"_s).get_description(), Xapian::Query("zz").get_description());
+
+    Xapian::Document document;
+    document.add_term("zzz");
+    m_db->replaceDocument(docCount + 1, document);
+    m_db->commit();
+
+    parser.setDatabase(m_db->db());
+    const QString description = QString::fromStdString(parser.expandWord(u"zz"_s).get_description());
+    QVERIFY(description.contains("zzz"_L1));
+}
+
+void QueryParserBenchmark::benchmarkExpansion_data()
+{
+    QTest::addColumn<QString>("prefix");
+
+    QTest::newRow("1 character") << u"a"_s;
+    QTest::newRow("2 characters") << u"ab"_s;
+    QTest::newRow("3 characters") << u"abc"_s;
+    QTest::newRow("4 characters") << u"abcd"_s;
+}
+
+void QueryParserBenchmark::benchmarkExpansion()
+{
+    QFETCH(QString, prefix);
+
+    XapianQueryParser parser;
+    parser.setDatabase(m_db->db());
+
+    // Up to 3 characters, the first lookup only reads a table from the metadata
+    QElapsedTimer timer;
+    timer.start();
+    Xapian::Query query = parser.parseQuery(prefix);
+    qDebug() << "First expansion of" << prefix << "took" << timer.nsecsElapsed() / 1000 << "µs";
+
+    QBENCHMARK {
+        query = parser.parseQuery(prefix);
+    }
+    QVERIFY(!query.empty());
+}
+
+QTEST_MAIN(QueryParserBenchmark)
+
+#include "moc_queryparserbenchmark.cpp"
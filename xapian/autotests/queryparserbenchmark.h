@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#pragma once
+
+#include <QObject>
+#include <QTemporaryDir>
+
+#include <memory>
+
+namespace Akonadi
+{
+namespace Search
+{
+class XapianDatabase;
+}
+}
+
+class QueryParserBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    QueryParserBenchmark();
+    ~QueryParserBenchmark() override;
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testExpansionIsCapped();
+    void testExpansionFollowsCommits();
+
+    void benchmarkExpansion_data();
+    void benchmarkExpansion();
+
+private:
+    QTemporaryDir m_dir;
+    std::unique_ptr<Akonadi::Search::XapianDatabase> m_db;
+};
@@ -218,6 +218,47 @@ void QueryParserTest::testWordExpansion()
     }
 }
 
+void QueryParserTest::testShortWordExpansion()
+{
+    QTemporaryDir dir;
+    XapianDatabase db(dir.path(), true);
+
+    // Many rare words sorting before a frequent one
+    Xapian::Document rare;
+    for (char c = 'a'; c <= 'g'; ++c) {
+        rare.add_term(std::string("t") + c);
+    }
+    rare.add_term("Tthe");
+    db.replaceDocument(1, rare);
+    for (uint id = 2; id <= 4; ++id) {
+        Xapian::Document doc;
+        doc.add_term("the");
+        db.replaceDocument(id, doc);
+    }
+    db.commit();
+
+    XapianQueryParser parser;
+    parser.setDatabase(db.db());
+    Xapian::Query query = parser.expandWord(u"t"_s);
+    QCOMPARE(query.get_num_subqueries(), std::size_t(8));
+    QCOMPARE(*query.get_subquery(0).get_terms_begin(), std::string("the"));
+
+    // The tables follow the commits
+    for (uint id = 5; id <= 8; ++id) {
+        Xapian::Document doc;
+        doc.add_term("tz");
+        db.replaceDocument(id, doc);
+    }
+    db.deleteDocument(1);
+    db.commit();
+
+    query = parser.expandWord(u"t"_s);
+    QCOMPARE(query.get_num_subqueries(), std::size_t(2));
+    QCOMPARE(*query.get_subquery(0).get_terms_begin(), std::string("tz"));
+    QCOMPARE(*query.get_subquery(1).get_terms_begin(), std::string("the"));
+    QCOMPARE(parser.expandWord(u"ta"_s).serialise(), Xapian::Query("ta").serialise());
+}
+
 QTEST_MAIN(QueryParserTest)
 
 #include "moc_queryparsertest.cpp"
@@ -25,4 +25,5 @@ private Q_SLOTS:
     void testUnderscoreSplitting();
 
     void testWordExpansion();
+    void testShortWordExpansion();
 };
@@ -153,6 +153,42 @@ void TermGeneratorTest::testWordPositions()
     QCOMPARE(it, end);
 }
 
+void TermGeneratorTest::testUtf8Overload()
+{
+    const QString str = QString::fromUtf8("Como está Kûg me@vhanda.in");
+    const QByteArray utf8 = str.toUtf8();
+
+    Xapian::Document doc;
+    XapianTermGenerator termGen(&doc);
+    termGen.indexText(str, QStringLiteral("SU"));
+
+    Xapian::Document utf8Doc;
+    XapianTermGenerator utf8TermGen(&utf8Doc);
+    utf8TermGen.indexText(std::string_view(utf8.constData(), utf8.size()), "SU");
+
+    QCOMPARE(allWords(utf8Doc), allWords(doc));
+    QCOMPARE(utf8TermGen.position(), termGen.position());
+}
+
+void TermGeneratorTest::testBigramTerms()
+{
+    const std::vector<std::string> terms = XapianTermGenerator::bigramTerms("Hello big World", "SU");
+    const std::vector<std::string> expected = {"XPSU:hello big", "XPSU:big world"};
+    QVERIFY(terms == expected);
+
+    QVERIFY(XapianTermGenerator::bigramTerms("single", "SU").empty());
+    QVERIFY(XapianTermGenerator::bigramTerms("", "SU").empty());
+}
+
+void TermGeneratorTest::testTrigramTerms()
+{
+    const std::vector<std::string> terms = XapianTermGenerator::trigramTerms("kûgs", "SU");
+    const std::vector<std::string> expected = {"XGSU:kûg", "XGSU:ûgs"};
+    QVERIFY(terms == expected);
+
+    QVERIFY(XapianTermGenerator::trigramTerms("ab", "SU").empty());
+}
+
 QTEST_MAIN(TermGeneratorTest)
 
 #include "moc_termgeneratortest.cpp"
@@ -21,4 +21,7 @@ private Q_SLOTS:
     void testUnicodeCompatibleComposition();
     void testEmails();
     void testWordPositions();
+    void testUtf8Overload();
+    void testBigramTerms();
+    void testTrigramTerms();
 };
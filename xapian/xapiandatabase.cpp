@@ -59,6 +59,7 @@ void XapianDatabase::replaceDocument(uint id, const Xapian::Document &doc)
     if (m_writeOnly) {
         try {
             m_wDb.replace_document(id, doc);
+            m_topTerms.noteDocument(doc);
         } catch (const Xapian::Error &) {
         }
         return;
@@ -74,6 +75,7 @@ void XapianDatabase::deleteDocument(uint id)
 
     if (m_writeOnly) {
         try {
+            m_topTerms.noteDocument(m_wDb.get_document(id));
             m_wDb.delete_document(id);
         } catch (const Xapian::Error &) {
         }
@@ -91,6 +93,7 @@ void XapianDatabase::commit()
 {
     if (m_writeOnly) {
         try {
+            m_topTerms.update(m_wDb);
             m_wDb.commit();
         } catch (const Xapian::Error &err) {
             qCWarning(AKONADI_SEARCH_XAPIAN_LOG) << err.get_error_string();
@@ -108,6 +111,7 @@ void XapianDatabase::commit()
     for (const DocXapianInfo &doc : std::as_const(m_docsToAdd)) {
         try {
             wdb.replace_document(doc.docId, doc.document);
+            m_topTerms.noteDocument(doc.document);
         } catch (const Xapian::Error &) {
         }
     }
@@ -115,12 +119,14 @@ void XapianDatabase::commit()
     qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << "Removing:" << m_docsToRemove.size() << "docs";
     for (Xapian::docid id : std::as_const(m_docsToRemove)) {
         try {
+            m_topTerms.noteDocument(wdb.get_document(id));
             wdb.delete_document(id);
         } catch (const Xapian::Error &) {
         }
     }
 
     try {
+        m_topTerms.update(wdb);
         wdb.commit();
         m_db->reopen();
     } catch (const Xapian::Error &err) {
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "search_xapian_export.h"
+#include "xapiantopterms.h"
 #include <xapian.h>
 
 #include <QList>
@@ -73,6 +74,7 @@ private:
 
     QList<DocXapianInfo> m_docsToAdd;
     QList<uint> m_docsToRemove;
+    XapianTopTerms m_topTerms;
 
     std::string m_path;
     const bool m_writeOnly = false;
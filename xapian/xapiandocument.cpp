@@ -8,6 +8,8 @@
 #include "xapiandocument.h"
 using namespace Qt::Literals::StringLiterals;
 
+#include <cstdio>
+
 using namespace Akonadi::Search;
 
 XapianDocument::XapianDocument()
@@ -21,23 +23,41 @@ XapianDocument::XapianDocument(const Xapian::Document &doc)
 {
 }
 
+namespace
+{
+std::string makeTerm(QByteArrayView prefix, QByteArrayView term)
+{
+    std::string str;
+    str.reserve(prefix.size() + term.size());
+    str.append(prefix.data(), prefix.size());
+    str.append(term.data(), term.size());
+    return str;
+}
+}
+
 void XapianDocument::addTerm(const QString &term, const QString &prefix)
 {
-    const QByteArray arr = prefix.toUtf8() + term.toUtf8();
+    addTerm(QByteArrayView(term.toUtf8()), QByteArrayView(prefix.toUtf8()));
+}
 
-    m_doc.add_term(arr.constData());
+void XapianDocument::addTerm(QByteArrayView term, QByteArrayView prefix)
+{
+    m_doc.add_term(makeTerm(prefix, term));
 }
 
 void XapianDocument::addBoolTerm(int term, const QString &prefix)
 {
-    addBoolTerm(QString::number(term), prefix);
+    addBoolTerm(QByteArrayView(QByteArray::number(term)), QByteArrayView(prefix.toUtf8()));
 }
 
 void XapianDocument::addBoolTerm(const QString &term, const QString &prefix)
 {
-    const QByteArray arr = prefix.toUtf8() + term.toUtf8();
+    addBoolTerm(QByteArrayView(term.toUtf8()), QByteArrayView(prefix.toUtf8()));
+}
 
-    m_doc.add_boolean_term(arr.constData());
+void XapianDocument::addBoolTerm(QByteArrayView term, QByteArrayView prefix)
+{
+    m_doc.add_boolean_term(makeTerm(prefix, term));
 }
 
 void XapianDocument::indexText(const QString &text, const QString &prefix, int wdfInc)
@@ -45,6 +65,11 @@ void XapianDocument::indexText(const QString &text, const QString &prefix, int w
     m_termGen.indexText(text, prefix, wdfInc);
 }
 
+void XapianDocument::indexText(std::string_view text, std::string_view prefix, int wdfInc)
+{
+    m_termGen.indexText(text, prefix, wdfInc);
+}
+
 void XapianDocument::indexText(const QString &text, int wdfInc)
 {
     indexText(text, QString(), wdfInc);
@@ -60,6 +85,43 @@ void XapianDocument::addValue(int pos, const QString &value)
     m_doc.add_value(pos, value.toStdString());
 }
 
+void XapianDocument::addNumericValue(int pos, double value)
+{
+    m_doc.add_value(pos, Xapian::sortable_serialise(value));
+}
+
+void XapianDocument::setData(const QByteArray &data)
+{
+    m_doc.set_data(std::string(data.constData(), data.size()));
+}
+
+void XapianDocument::addDateTerms(QDate date)
+{
+    if (!date.isValid()) {
+        return;
+    }
+    m_doc.add_boolean_term(dateTerm(date.year()));
+    m_doc.add_boolean_term(dateTerm(date.year(), date.month()));
+    m_doc.add_boolean_term(dateTerm(date.year(), date.month(), date.day()));
+}
+
+std::string XapianDocument::dateTerm(int year, int month, int day)
+{
+    if (year < 0) {
+        return {};
+    }
+
+    char term[32];
+    if (month < 0) {
+        std::snprintf(term, sizeof(term), "XY%04d", year);
+    } else if (day < 0) {
+        std::snprintf(term, sizeof(term), "XYM%04d%02d", year, month);
+    } else {
+        std::snprintf(term, sizeof(term), "XYMD%04d%02d%02d", year, month, day);
+    }
+    return term;
+}
+
 QString XapianDocument::fetchTermStartsWith(const QByteArray &term)
 {
     try {
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <QByteArrayView>
+#include <QDate>
 #include <QString>
+#include <string_view>
 #include <xapian.h>
 
 #include "search_xapian_export.h"
@@ -44,17 +47,56 @@ public:
      */
     void addBoolTerm(int term, const QString &prefix);
 
+    /*!
+     * UTF-8 variant of addTerm(), the term is built without going through QString.
+     */
+    void addTerm(QByteArrayView term, QByteArrayView prefix = {});
+    /*!
+     * UTF-8 variant of addBoolTerm(), the term is built without going through QString.
+     */
+    void addBoolTerm(QByteArrayView term, QByteArrayView prefix = {});
+
     /*!
      */
     void indexText(const QString &text, int wdfInc = 1);
     /*!
      */
     void indexText(const QString &text, const QString &prefix, int wdfInc = 1);
+    /*!
+     * Indexes UTF-8 encoded \a text without copying it first.
+     */
+    void indexText(std::string_view text, std::string_view prefix = {}, int wdfInc = 1);
 
     /*!
      */
     void addValue(int pos, const QString &value);
 
+    /*!
+     * Stores the number \a value in the slot \a pos, encoded with
+     * Xapian::sortable_serialise() so that range queries and sorting
+     * compare it numerically.
+     */
+    void addNumericValue(int pos, double value);
+
+    /*!
+     * Adds the boolean year, year-month and year-month-day terms of \a date,
+     * as built by dateTerm().
+     */
+    void addDateTerms(QDate date);
+
+    /*!
+     * Returns the term of the day \a year-\a month-\a day, or of the whole
+     * month or year when \a day or \a month is -1.
+     * Returns an empty string when \a year is -1.
+     */
+    [[nodiscard]] static std::string dateTerm(int year, int month = -1, int day = -1);
+
+    /*!
+     * Stores \a data as the opaque data of the document, returned along with
+     * the matches without looking the item up elsewhere.
+     */
+    void setData(const QByteArray &data);
+
     /*!
      */
     [[nodiscard]] Xapian::Document doc() const;
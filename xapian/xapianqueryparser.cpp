@@ -9,9 +9,14 @@
 using namespace Qt::Literals::StringLiterals;
 
 #include "akonadi_search_xapian_debug.h"
+#include "xapiantopterms.h"
 #include <QStringList>
 #include <QTextBoundaryFinder>
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 using namespace Akonadi::Search;
 
 XapianQueryParser::XapianQueryParser() = default;
@@ -25,7 +30,7 @@ namespace
 {
 struct Term {
     std::string t;
-    uint count;
+    Xapian::doccount count;
 
     // pop_heap pops the largest element, we want the smallest to be popped
     bool operator<(const Term &rhs) const
@@ -34,49 +39,66 @@ struct Term {
     }
 };
 
-Xapian::Query makeQuery(const QString &string, int position, Xapian::Database *db)
+/*
+ * Returns the most frequent terms starting with \a prefix, the most frequent
+ * first. The term frequency comes with the dictionary entry, so this does not
+ * do a lookup per term.
+ *
+ * Short prefixes start most of the dictionary, their terms come from the
+ * tables the writers of the database keep, see XapianTopTerms. Only databases
+ * without them have all of their terms read.
+ */
+std::vector<std::string> expansion(const Xapian::Database &db, const std::string &prefix)
 {
-    if (!db) {
-        const QByteArray arr = string.toUtf8();
-        const std::string stdString(arr.constData(), arr.size());
-        return Xapian::Query(stdString, 1, position);
+    if (std::optional<std::vector<std::string>> terms = XapianTopTerms::read(db, prefix)) {
+        return std::move(*terms);
     }
 
     // Lets just keep the top x (+1 for push_heap)
-    static const int MaxTerms = 100;
-    QList<Term> topTerms;
-    topTerms.reserve(MaxTerms + 1);
+    std::vector<Term> heap;
+    heap.reserve(XapianTopTerms::MaxTerms + 1);
 
-    const std::string stdString(string.toStdString());
-    Xapian::TermIterator it = db->allterms_begin(stdString);
-    Xapian::TermIterator end = db->allterms_end(stdString);
+    Xapian::TermIterator it = db.allterms_begin(prefix);
+    const Xapian::TermIterator end = db.allterms_end(prefix);
     for (; it != end; ++it) {
-        Term term;
-        term.t = *it;
-        term.count = db->get_collection_freq(term.t);
-
-        if (topTerms.size() < MaxTerms) {
-            topTerms.push_back(term);
-            std::push_heap(topTerms.begin(), topTerms.end());
-        } else {
+        heap.push_back({*it, it.get_termfreq()});
+        std::push_heap(heap.begin(), heap.end());
+        if (heap.size() > static_cast<std::size_t>(XapianTopTerms::MaxTerms)) {
             // Remove the term with the min count
-            topTerms.push_back(term);
-            std::push_heap(topTerms.begin(), topTerms.end());
-
-            std::pop_heap(topTerms.begin(), topTerms.end());
-            topTerms.pop_back();
+            std::pop_heap(heap.begin(), heap.end());
+            heap.pop_back();
         }
     }
 
-    QList<Xapian::Query> queries;
-    queries.reserve(topTerms.size());
+    std::sort(heap.begin(), heap.end(), [](const Term &a, const Term &b) {
+        return a.count != b.count ? a.count > b.count : a.t < b.t;
+    });
 
-    for (const Term &term : std::as_const(topTerms)) {
-        queries << Xapian::Query(term.t, 1, position);
+    std::vector<std::string> terms;
+    terms.reserve(heap.size());
+    for (Term &term : heap) {
+        terms.push_back(std::move(term.t));
     }
+    return terms;
+}
 
-    if (queries.isEmpty()) {
-        return Xapian::Query(string.toStdString(), 1, position);
+Xapian::Query makeQuery(const QString &string, int position, Xapian::Database *db)
+{
+    const QByteArray arr = string.toUtf8();
+    const std::string stdString(arr.constData(), arr.size());
+    if (!db) {
+        return Xapian::Query(stdString, 1, position);
+    }
+
+    const std::vector<std::string> terms = expansion(*db, stdString);
+    if (terms.empty()) {
+        return Xapian::Query(stdString, 1, position);
+    }
+
+    QList<Xapian::Query> queries;
+    queries.reserve(terms.size());
+    for (const std::string &term : terms) {
+        queries << Xapian::Query(term, 1, position);
     }
     Xapian::Query finalQ(Xapian::Query::OP_SYNONYM, queries.begin(), queries.end());
     return finalQ;
@@ -225,12 +247,12 @@ void XapianQueryParser::setAutoExapand(bool autoexpand)
 Xapian::Query XapianQueryParser::expandWord(const QString &word, const QString &prefix)
 {
     const std::string stdString((prefix + word).toUtf8().constData());
-    Xapian::TermIterator it = m_db->allterms_begin(stdString);
-    Xapian::TermIterator end = m_db->allterms_end(stdString);
+    const std::vector<std::string> terms = expansion(*m_db, stdString);
 
     QList<Xapian::Query> queries;
-    for (; it != end; ++it) {
-        queries << Xapian::Query(*it);
+    queries.reserve(terms.size());
+    for (const std::string &term : terms) {
+        queries << Xapian::Query(term);
     }
 
     if (queries.isEmpty()) {
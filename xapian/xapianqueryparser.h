@@ -32,13 +32,17 @@ public:
     [[nodiscard]] Xapian::Query parseQuery(const QString &str, const QString &prefix = QString());
 
     /*!
-     * Expands word to every possible option which it can be expanded to.
+     * Expands word to the most frequent terms it can be expanded to.
+     *
+     * Like the automatic expansion of parseQuery(), it is capped to 100
+     * terms. Words up to 3 characters are looked up in the tables the
+     * writers of the database keep, see XapianTopTerms.
      */
     [[nodiscard]] Xapian::Query expandWord(const QString &word, const QString &prefix = QString());
 
     /*!
      * Set if each word in the string should be treated as a partial word
-     * and should be expanded to every possible word.
+     * and should be expanded to the most frequent words it is a prefix of.
      */
     void setAutoExapand(bool autoexpand);
 
@@ -10,35 +10,61 @@
 using namespace Qt::Literals::StringLiterals;
 
 #include "query.h"
+#include "xapiandocument.h"
 #include "xapianqueryparser.h"
 
 #include "akonadi_search_xapian_debug.h"
 #include <QList>
+#include <QThread>
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 using namespace Akonadi::Search;
 
-XapianSearchStore::XapianSearchStore(QObject *parent)
-    : SearchStore(parent)
+namespace
+{
+// The database exec() builds the query of the calling thread against
+thread_local const XapianSearchStore *t_execStore = nullptr;
+thread_local Xapian::Database *t_execDatabase = nullptr;
 
+class ExecDatabaseScope
 {
+public:
+    ExecDatabaseScope(const XapianSearchStore *store, Xapian::Database *db)
+        : m_previousStore(std::exchange(t_execStore, store))
+        , m_previousDatabase(std::exchange(t_execDatabase, db))
+    {
+    }
+
+    ~ExecDatabaseScope()
+    {
+        t_execStore = m_previousStore;
+        t_execDatabase = m_previousDatabase;
+    }
+
+private:
+    const XapianSearchStore *const m_previousStore;
+    Xapian::Database *const m_previousDatabase;
+};
 }
 
-XapianSearchStore::~XapianSearchStore()
+XapianSearchStore::XapianSearchStore(QObject *parent)
+    : SearchStore(parent)
+
 {
-    delete m_db;
 }
 
+XapianSearchStore::~XapianSearchStore() = default;
+
 void XapianSearchStore::setDbPath(const QString &path)
 {
     m_dbPath = path;
 
-    delete m_db;
-    m_db = nullptr;
-
+    std::vector<Xapian::Database> databases;
     try {
-        m_db = new Xapian::Database(m_dbPath.toStdString());
+        databases.emplace_back(m_dbPath.toStdString());
     } catch (const Xapian::DatabaseOpeningError &) {
         qCWarning(AKONADI_SEARCH_XAPIAN_LOG) << "Xapian Database does not exist at " << m_dbPath;
     } catch (const Xapian::DatabaseCorruptError &) {
@@ -46,6 +72,10 @@ void XapianSearchStore::setDbPath(const QString &path)
     } catch (...) {
         qCWarning(AKONADI_SEARCH_XAPIAN_LOG) << "Random exception, but we do not want to crash";
     }
+
+    QMutexLocker lock(&m_mutex);
+    m_hasDb = !databases.empty();
+    m_idleDatabases = std::move(databases);
 }
 
 QString XapianSearchStore::dbPath()
@@ -106,24 +136,64 @@ Xapian::Query XapianSearchStore::andQuery(const Xapian::Query &a, const Xapian::
 Xapian::Query XapianSearchStore::constructSearchQuery(const QString &str)
 {
     XapianQueryParser parser;
-    parser.setDatabase(m_db);
+    parser.setDatabase(xapianDb());
     return parser.parseQuery(str);
 }
 
-int XapianSearchStore::exec(const Query &query)
+bool XapianSearchStore::acquireDatabase(Xapian::Database &db)
 {
-    if (!m_db) {
-        return 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_hasDb) {
+            return false;
+        }
+        if (!m_idleDatabases.empty()) {
+            db = std::move(m_idleDatabases.back());
+            m_idleDatabases.pop_back();
+            return true;
+        }
+    }
+
+    // All the handles are busy with other queries, open another one
+    try {
+        db = Xapian::Database(m_dbPath.toStdString());
+    } catch (const Xapian::Error &e) {
+        qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << "Failed to open database" << m_dbPath << ":" << QString::fromStdString(e.get_msg());
+        return false;
     }
+    return true;
+}
+
+void XapianSearchStore::releaseDatabase(std::shared_ptr<Result> &&res)
+{
+    // The results refer to the database, let them go before another query gets it
+    Xapian::Database db = std::move(res->db);
+    res.reset();
 
+    QMutexLocker lock(&m_mutex);
+    // Keep about one handle per thread searching at the same time
+    if (m_idleDatabases.size() < static_cast<std::size_t>(std::max(QThread::idealThreadCount(), 1))) {
+        m_idleDatabases.push_back(std::move(db));
+    }
+}
+
+std::shared_ptr<XapianSearchStore::Result> XapianSearchStore::result(int queryId)
+{
+    QMutexLocker lock(&m_mutex);
+    return m_queryMap.value(queryId);
+}
+
+bool XapianSearchStore::execQuery(const Query &query, Result &res)
+{
+    const ExecDatabaseScope scope(this, &res.db);
     while (true) {
         try {
-            QMutexLocker lock(&m_mutex);
+            // The only revision check of the query, its results and documents are read at it
             try {
-                m_db->reopen();
+                res.db.reopen();
             } catch (Xapian::DatabaseError &e) {
                 qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << "Failed to reopen database" << dbPath() << ":" << QString::fromStdString(e.get_msg());
-                return 0;
+                return false;
             }
 
             Xapian::Query xapQ = toXapianQuery(query.term());
@@ -131,7 +201,7 @@ int XapianSearchStore::exec(const Query &query)
             // must not exist
             if (!query.term().empty() && xapQ.empty()) {
                 qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << query.term() << "could not be processed. Aborting";
-                return 0;
+                return false;
             }
             if (!query.searchString().isEmpty()) {
                 QString str = query.searchString();
@@ -142,87 +212,153 @@ int XapianSearchStore::exec(const Query &query)
             xapQ = andQuery(xapQ, convertTypes(query.types()));
             xapQ = andQuery(xapQ, constructFilterQuery(query.yearFilter(), query.monthFilter(), query.dayFilter()));
             xapQ = applyCustomOptions(xapQ, query.customOptions());
-            xapQ = finalizeQuery(xapQ);
+            // Ranking is wasted work when the caller does not want it
+            if (query.sortingOption() == Query::SortAuto) {
+                xapQ = finalizeQuery(xapQ);
+            }
 
             if (xapQ.empty()) {
                 // Return all the results
                 xapQ = Xapian::Query(std::string());
             }
-            Xapian::Enquire enquire(*m_db);
+            Xapian::Enquire enquire(res.db);
             enquire.set_query(xapQ);
 
             if (query.sortingOption() == Query::SortNone) {
                 enquire.set_weighting_scheme(Xapian::BoolWeight());
+            } else if (query.sortingOption() == Query::SortProperty && setSortKeys(enquire, query.sortingProperty())) {
+                // Relevance is not used, do not compute it
+                enquire.set_weighting_scheme(Xapian::BoolWeight());
             }
 
-            Result &res = m_queryMap[m_nextId++];
-            res.mset = enquire.get_mset(query.offset(), query.limit());
+            // Paged queries fetch their results a page at a time, from the revision of the first page
+            res.pageSize = query.pageSize() ? std::min(query.pageSize(), query.limit()) : query.limit();
+            res.mset = enquire.get_mset(query.offset(), res.pageSize);
             res.it = res.mset.begin();
-
-            return m_nextId - 1;
+            res.nextOffset = query.offset() + res.mset.size();
+            res.remaining = query.limit() - res.mset.size();
+            if (res.remaining > 0 && res.mset.size() == res.pageSize) {
+                res.enquire = enquire;
+            }
+            return true;
         } catch (const Xapian::DatabaseModifiedError &) {
             continue;
         } catch (const Xapian::Error &) {
-            return 0;
+            return false;
         }
     }
+}
+
+int XapianSearchStore::exec(const Query &query)
+{
+    auto res = std::make_shared<Result>();
+    if (!acquireDatabase(res->db)) {
+        return 0;
+    }
+    if (!execQuery(query, *res)) {
+        releaseDatabase(std::move(res));
+        return 0;
+    }
 
-    return 0;
+    QMutexLocker lock(&m_mutex);
+    const int queryId = m_nextId++;
+    m_queryMap.insert(queryId, res);
+    return queryId;
 }
 
 void XapianSearchStore::close(int queryId)
 {
-    QMutexLocker lock(&m_mutex);
-    m_queryMap.remove(queryId);
+    std::shared_ptr<Result> res;
+    {
+        QMutexLocker lock(&m_mutex);
+        res = m_queryMap.take(queryId);
+    }
+    if (res) {
+        releaseDatabase(std::move(res));
+    }
 }
 
 QByteArray XapianSearchStore::id(int queryId)
 {
-    QMutexLocker lock(&m_mutex);
-    Q_ASSERT_X(m_queryMap.contains(queryId), "FileSearchStore::id", "Passed a queryId which does not exist");
+    const std::shared_ptr<Result> res = result(queryId);
+    Q_ASSERT_X(res, "FileSearchStore::id", "Passed a queryId which does not exist");
 
-    const Result res = m_queryMap.value(queryId);
-    if (!res.lastId) {
+    if (!res || !res->lastId) {
         return {};
     }
 
-    return serialize(idPrefix(), res.lastId);
+    return serialize(idPrefix(), res->lastId);
 }
 
-QUrl XapianSearchStore::url(int queryId)
+qint64 XapianSearchStore::numericId(int queryId)
 {
-    QMutexLocker lock(&m_mutex);
-    Result &res = m_queryMap[queryId];
+    const std::shared_ptr<Result> res = result(queryId);
+    return res ? res->lastId : 0;
+}
 
-    if (!res.lastId) {
+QUrl XapianSearchStore::url(int queryId)
+{
+    const std::shared_ptr<Result> res = result(queryId);
+    if (!res || !res->lastId) {
         return {};
     }
 
-    if (!res.lastUrl.isEmpty()) {
-        return res.lastUrl;
+    if (!res->lastUrl.isEmpty()) {
+        return res->lastUrl;
     }
 
-    res.lastUrl = constructUrl(res.lastId);
-    return res.lastUrl;
+    res->lastUrl = constructUrl(res->lastId);
+    return res->lastUrl;
+}
+
+void XapianSearchStore::fetchNextPage(Result &res)
+{
+    if (!res.enquire) {
+        return;
+    }
+
+    const Xapian::doccount count = std::min(res.pageSize, res.remaining);
+    try {
+        res.mset = res.enquire->get_mset(res.nextOffset, count);
+    } catch (const Xapian::DatabaseModifiedError &) {
+        // The revision of the query is gone, the remaining pages can only be read at the latest one
+        try {
+            res.db.reopen();
+            res.mset = res.enquire->get_mset(res.nextOffset, count);
+        } catch (const Xapian::Error &e) {
+            qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << "Failed to fetch the next results:" << QString::fromStdString(e.get_msg());
+            res.mset = Xapian::MSet();
+        }
+    } catch (const Xapian::Error &e) {
+        qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << "Failed to fetch the next results:" << QString::fromStdString(e.get_msg());
+        res.mset = Xapian::MSet();
+    }
+    res.it = res.mset.begin();
+    res.nextOffset += res.mset.size();
+    res.remaining -= res.mset.size();
+    if (res.remaining == 0 || res.mset.size() < count) {
+        res.enquire.reset();
+    }
 }
 
 bool XapianSearchStore::next(int queryId)
 {
-    if (!m_db) {
+    const std::shared_ptr<Result> res = result(queryId);
+    if (!res) {
         return false;
     }
 
-    QMutexLocker lock(&m_mutex);
-    Result &res = m_queryMap[queryId];
-
-    bool atEnd = (res.it == res.mset.end());
+    if (res->it == res->mset.end()) {
+        fetchNextPage(*res);
+    }
+    bool atEnd = (res->it == res->mset.end());
     if (atEnd) {
-        res.lastId = 0;
-        res.lastUrl.clear();
+        res->lastId = 0;
+        res->lastUrl.clear();
     } else {
-        res.lastId = *res.it;
-        res.lastUrl.clear();
-        ++res.it;
+        res->lastId = *res->it;
+        res->lastUrl.clear();
+        ++res->it;
     }
 
     return !atEnd;
@@ -230,24 +366,23 @@ bool XapianSearchStore::next(int queryId)
 
 Xapian::Document XapianSearchStore::docForQuery(int queryId)
 {
-    if (!m_db) {
+    const std::shared_ptr<Result> res = result(queryId);
+    if (!res || !res->lastId) {
         return {};
     }
 
-    QMutexLocker lock(&m_mutex);
-
     try {
-        const Result &res = m_queryMap.value(queryId);
-        if (!res.lastId) {
-            return {};
-        }
-
-        return m_db->get_document(res.lastId);
+        return res->db.get_document(res->lastId);
     } catch (const Xapian::DocNotFoundError &) {
         return {};
     } catch (const Xapian::DatabaseModifiedError &) {
-        m_db->reopen();
-        return docForQuery(queryId);
+        // The revision of the query is gone, the document can only be read at the latest one
+        try {
+            res->db.reopen();
+            return res->db.get_document(res->lastId);
+        } catch (const Xapian::Error &) {
+            return {};
+        }
     } catch (const Xapian::Error &) {
         return {};
     }
@@ -255,15 +390,61 @@ Xapian::Document XapianSearchStore::docForQuery(int queryId)
 
 Xapian::Database *XapianSearchStore::xapianDb()
 {
-    return m_db;
+    return t_execStore == this ? t_execDatabase : nullptr;
 }
 
 Xapian::Query XapianSearchStore::constructFilterQuery(int year, int month, int day)
 {
-    Q_UNUSED(year)
-    Q_UNUSED(month)
-    Q_UNUSED(day)
-    return {};
+    // A day without a month does not mean anything, filter on the year then
+    if (month < 0) {
+        day = -1;
+    }
+    const std::string term = XapianDocument::dateTerm(year, month, day);
+    if (term.empty()) {
+        return {};
+    }
+    return Xapian::Query(term);
+}
+
+bool XapianSearchStore::setSortKeys(Xapian::Enquire &enquire, const QString &sortingProperty)
+{
+    std::vector<std::pair<Xapian::valueno, bool>> keys;
+    const QStringList properties = sortingProperty.split(u',', Qt::SkipEmptyParts);
+    for (QString property : properties) {
+        property = property.trimmed();
+        const bool descending = property.startsWith(u'-');
+        if (descending) {
+            property.remove(0, 1);
+        }
+        const Xapian::valueno slot = sortingValue(property.toLower());
+        if (slot == Xapian::BAD_VALUENO) {
+            qCDebug(AKONADI_SEARCH_XAPIAN_LOG) << "Cannot sort on" << property;
+            continue;
+        }
+        keys.emplace_back(slot, descending);
+    }
+
+    if (keys.empty()) {
+        return false;
+    }
+    // The matcher only keeps the best offset + limit documents, so a small
+    // limit does not sort the whole result set
+    if (keys.size() == 1) {
+        enquire.set_sort_by_value(keys.front().first, keys.front().second);
+    } else {
+        auto keyMaker = new Xapian::MultiValueKeyMaker;
+        for (const auto &[slot, descending] : keys) {
+            keyMaker->add_value(slot, descending);
+        }
+        enquire.set_sort_by_key(keyMaker->release(), false);
+    }
+    return true;
+}
+
+Xapian::valueno XapianSearchStore::sortingValue(const QString &property)
+{
+    Q_UNUSED(property)
+    return Xapian::BAD_VALUENO;
 }
 
 Xapian::Query XapianSearchStore::finalizeQuery(const Xapian::Query &query)
@@ -14,7 +14,11 @@
 #include "core/term.h"
 #include "search_xapian_export.h"
 
-#include <QMutexLocker>
+#include <QMutex>
+
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace Akonadi
 {
@@ -22,6 +26,11 @@ namespace Search
 {
 /*!
  * Implements a search store using Xapian
+ *
+ * Queries can be executed from several threads at the same time. Each query
+ * gets a read handle of its own for its lifetime, taken from a pool of idle
+ * handles, so only the bookkeeping of the store is serialized. A single query
+ * must not be used from several threads at once.
  */
 class AKONADI_SEARCH_XAPIAN_EXPORT XapianSearchStore : public SearchStore
 {
@@ -47,12 +56,18 @@ public:
     /*!
      */
     [[nodiscard]] QByteArray id(int queryId) override;
+    /*!
+     * Returns the document id of the current result, without serializing it.
+     */
+    [[nodiscard]] qint64 numericId(int queryId) override;
     /*!
      */
     [[nodiscard]] QUrl url(int queryId) override;
 
     /*!
      * Set the path of the xapian database
+     *
+     * Not thread-safe, set it before executing queries.
      */
     virtual void setDbPath(const QString &path);
     /*!
@@ -69,7 +84,9 @@ protected:
     virtual Xapian::Query constructFilterQuery(int year, int month, int day);
 
     /*!
-     * Apply any final touches to the query
+     * Apply any final touches to the query, such as ranking.
+     *
+     * Only called for queries using Query::SortAuto.
      */
     virtual Xapian::Query finalizeQuery(const Xapian::Query &query);
 
@@ -90,6 +107,12 @@ protected:
      */
     virtual Xapian::Query convertTypes(const QStringList &types) = 0;
 
+    /*!
+     * Returns the value slot which \a property is stored in, so results
+     * can be sorted on it, or Xapian::BAD_VALUENO if it cannot be sorted on.
+     */
+    virtual Xapian::valueno sortingValue(const QString &property);
+
     /*!
      * The prefix that should be used when converting an integer
      * id to a byte array
@@ -103,31 +126,50 @@ protected:
      */
     Xapian::Query andQuery(const Xapian::Query &a, const Xapian::Query &b);
 
+    /*!
+     * The database of the query being constructed by exec() in the calling
+     * thread, nullptr outside of it.
+     */
     Xapian::Database *xapianDb();
 
-protected:
-    QRecursiveMutex m_mutex;
-
 private:
     [[nodiscard]] AKONADI_SEARCH_XAPIAN_NO_EXPORT Xapian::Query toXapianQuery(const Term &term);
     [[nodiscard]] AKONADI_SEARCH_XAPIAN_NO_EXPORT Xapian::Query toXapianQuery(Xapian::Query::op op, const QList<Term> &terms);
 
     [[nodiscard]] AKONADI_SEARCH_XAPIAN_NO_EXPORT Xapian::Query constructSearchQuery(const QString &str);
+    AKONADI_SEARCH_XAPIAN_NO_EXPORT bool setSortKeys(Xapian::Enquire &enquire, const QString &sortingProperty);
 
     struct Result {
+        // Only used by this query, the results were found at its revision
+        Xapian::Database db;
+        // Fetches the next pages of a paged query, see Query::setPageSize()
+        std::optional<Xapian::Enquire> enquire;
+        Xapian::doccount pageSize = 0;
+        Xapian::doccount nextOffset = 0;
+        Xapian::doccount remaining = 0;
+
         Xapian::MSet mset;
         Xapian::MSetIterator it;
 
-        uint lastId;
+        uint lastId = 0;
         QUrl lastUrl;
     };
 
-    QHash<int, Result> m_queryMap;
+    [[nodiscard]] AKONADI_SEARCH_XAPIAN_NO_EXPORT bool execQuery(const Query &query, Result &res);
+    AKONADI_SEARCH_XAPIAN_NO_EXPORT void fetchNextPage(Result &res);
+    [[nodiscard]] AKONADI_SEARCH_XAPIAN_NO_EXPORT std::shared_ptr<Result> result(int queryId);
+    [[nodiscard]] AKONADI_SEARCH_XAPIAN_NO_EXPORT bool acquireDatabase(Xapian::Database &db);
+    AKONADI_SEARCH_XAPIAN_NO_EXPORT void releaseDatabase(std::shared_ptr<Result> &&res);
+
+    // Guards the members below, never held while Xapian is working
+    QMutex m_mutex;
+    QHash<int, std::shared_ptr<Result>> m_queryMap;
+    // Read handles no query is using
+    std::vector<Xapian::Database> m_idleDatabases;
     int m_nextId = 1;
 
     QString m_dbPath;
-
-    Xapian::Database *m_db = nullptr;
+    bool m_hasDb = false;
 };
 }
 }
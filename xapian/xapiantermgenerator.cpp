@@ -70,19 +70,88 @@ QStringList XapianTermGenerator::termList(const QString &text)
     return list;
 }
 
+std::vector<std::string> XapianTermGenerator::bigramTerms(std::string_view text, std::string_view prefix)
+{
+    // Let Xapian split the words, so they are the same as the indexed terms
+    Xapian::Document doc;
+    Xapian::TermGenerator termGen;
+    termGen.set_document(doc);
+    termGen.index_text(Xapian::Utf8Iterator(text.data(), text.size()));
+
+    std::vector<std::string> words(termGen.get_termpos());
+    for (auto it = doc.termlist_begin(), end = doc.termlist_end(); it != end; ++it) {
+        for (auto pos = it.positionlist_begin(), posEnd = it.positionlist_end(); pos != posEnd; ++pos) {
+            words[*pos - 1] = *it;
+        }
+    }
+
+    std::vector<std::string> terms;
+    std::string term;
+    for (std::size_t i = 1; i < words.size(); ++i) {
+        if (words[i - 1].empty() || words[i].empty()) {
+            continue;
+        }
+        term.assign("XP");
+        term.append(prefix);
+        term.push_back(':');
+        term.append(words[i - 1]);
+        term.push_back(' ');
+        term.append(words[i]);
+        // Xapian's limit on the length of a term
+        if (term.size() <= 245) {
+            terms.push_back(term);
+        }
+    }
+    return terms;
+}
+
+std::vector<std::string> XapianTermGenerator::trigramTerms(std::string_view term, std::string_view prefix)
+{
+    // Byte offsets of the characters, a trigram spans three of them
+    std::vector<std::size_t> offsets;
+    for (Xapian::Utf8Iterator it(term.data(), term.size()), end; it != end; ++it) {
+        offsets.push_back(it.raw() - term.data());
+    }
+    offsets.push_back(term.size());
+
+    std::vector<std::string> terms;
+    std::string trigram;
+    for (std::size_t i = 3; i < offsets.size(); ++i) {
+        trigram.assign("XG");
+        trigram.append(prefix);
+        trigram.push_back(':');
+        trigram.append(term.substr(offsets[i - 3], offsets[i] - offsets[i - 3]));
+        terms.push_back(trigram);
+    }
+    return terms;
+}
+
 void XapianTermGenerator::indexText(const QString &text, const QString &prefix, int wdfInc)
 {
-    const QByteArray par = prefix.toUtf8();
+    const std::string par = prefix.toStdString();
     const QByteArray ta = text.toUtf8();
-    m_termGen.index_text(ta.constData(), wdfInc, par.constData());
+    m_termGen.index_text(Xapian::Utf8Iterator(ta.constData(), ta.size()), wdfInc, par);
+
+    addPostings(termList(text), par, wdfInc);
+}
 
-    const QStringList terms = termList(text);
-    for (const QString &term : terms) {
-        const QByteArray arr = term.toUtf8();
+void XapianTermGenerator::indexText(std::string_view text, std::string_view prefix, int wdfInc)
+{
+    const std::string par(prefix);
+    m_termGen.index_text(Xapian::Utf8Iterator(text.data(), text.size()), wdfInc, par);
 
-        const QByteArray finalArr = par + arr;
-        const std::string stdString(finalArr.constData(), finalArr.size());
-        m_doc->add_posting(stdString, m_position, wdfInc);
+    addPostings(termList(QString::fromUtf8(text.data(), text.size())), par, wdfInc);
+}
+
+void XapianTermGenerator::addPostings(const QStringList &terms, const std::string &prefix, int wdfInc)
+{
+    // Reuse the same buffer for every term
+    std::string term;
+    for (const QString &t : terms) {
+        const QByteArray arr = t.toUtf8();
+        term.assign(prefix);
+        term.append(arr.constData(), arr.size());
+        m_doc->add_posting(term, m_position, wdfInc);
 
         m_position++;
     }
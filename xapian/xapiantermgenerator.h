@@ -11,6 +11,9 @@
 
 #include "search_xapian_export.h"
 #include <QString>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace Akonadi
 {
@@ -30,6 +33,11 @@ public:
     /*!
      */
     void indexText(const QString &text, const QString &prefix, int wdfInc = 1);
+    /*!
+     * Indexes UTF-8 encoded \a text. Xapian reads the bytes in place,
+     * only the word splitting needs a decoded copy.
+     */
+    void indexText(std::string_view text, std::string_view prefix, int wdfInc = 1);
 
     /*!
      */
@@ -46,7 +54,34 @@ public:
      */
     [[nodiscard]] static QStringList termList(const QString &text);
 
+    /*!
+     * Returns the word bigram terms ("XP<prefix>:<word> <word>") of the
+     * UTF-8 encoded \a text. They allow matching phrases on databases
+     * indexed without positions, for a fraction of their size.
+     */
+    [[nodiscard]] static std::vector<std::string> bigramTerms(std::string_view text, std::string_view prefix);
+
+    /*!
+     * Returns the trigram terms ("XG<prefix>:<three characters>") of
+     * the UTF-8 encoded \a term, without its prefix. Documents containing
+     * all trigrams of a string are candidates for containing it.
+     */
+    [[nodiscard]] static std::vector<std::string> trigramTerms(std::string_view term, std::string_view prefix);
+
+    /*!
+     * Database metadata key listing the comma separated prefixes
+     * which have bigram terms for every document.
+     */
+    static constexpr const char *bigramMetadataKey = "phrasebigrams";
+    /*!
+     * Database metadata key listing the comma separated prefixes
+     * which have trigram terms for every document.
+     */
+    static constexpr const char *trigramMetadataKey = "substringtrigrams";
+
 private:
+    void addPostings(const QStringList &terms, const std::string &prefix, int wdfInc);
+
     Xapian::Document *m_doc = nullptr;
     Xapian::TermGenerator m_termGen;
 
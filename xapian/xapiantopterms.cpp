@@ -0,0 +1,202 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#include "xapiantopterms.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+using namespace Akonadi::Search;
+
+namespace
+{
+// Set once the database has tables, they are kept up to date from then on
+constexpr char MarkerKey[] = "topterms";
+constexpr char TableKeyPrefix[] = "topterms:";
+
+struct Entry {
+    std::string term;
+    Xapian::doccount freq;
+};
+
+using Table = std::vector<Entry>;
+
+// Xapian prefixes are upper case
+bool isPrefixed(const std::string &term)
+{
+    return !term.empty() && term[0] >= 'A' && term[0] <= 'Z';
+}
+
+// The prefixes of term of up to MaxPrefixLength characters, the shortest first
+std::vector<std::string> shortPrefixes(const std::string &term)
+{
+    std::vector<std::string> prefixes;
+    for (std::size_t pos = 1; pos <= term.size() && prefixes.size() < static_cast<std::size_t>(XapianTopTerms::MaxPrefixLength); ++pos) {
+        // Cut before a UTF-8 lead byte only
+        if (pos == term.size() || (static_cast<unsigned char>(term[pos]) & 0xC0) != 0x80) {
+            prefixes.push_back(term.substr(0, pos));
+        }
+    }
+    return prefixes;
+}
+
+int characterCount(const std::string &str)
+{
+    return static_cast<int>(std::count_if(str.cbegin(), str.cend(), [](char ch) {
+        return (static_cast<unsigned char>(ch) & 0xC0) != 0x80;
+    }));
+}
+
+// The most frequent first, MaxTerms at most
+void trim(Table &table)
+{
+    std::sort(table.begin(), table.end(), [](const Entry &a, const Entry &b) {
+        return a.freq != b.freq ? a.freq > b.freq : a.term < b.term;
+    });
+    if (table.size() > static_cast<std::size_t>(XapianTopTerms::MaxTerms)) {
+        table.resize(XapianTopTerms::MaxTerms);
+    }
+}
+
+// Big endian frequency and term, each term ended by a null byte
+std::string serialize(const Table &table)
+{
+    std::string data;
+    for (const Entry &entry : table) {
+        char bytes[4];
+        qToBigEndian<quint32>(entry.freq, bytes);
+        data.append(bytes, 4);
+        data.append(entry.term);
+        data.push_back('\0');
+    }
+    return data;
+}
+
+Table deserialize(const std::string &data)
+{
+    Table table;
+    std::size_t pos = 0;
+    while (pos + 4 < data.size()) {
+        const Xapian::doccount freq = qFromBigEndian<quint32>(data.data() + pos);
+        pos += 4;
+        const std::size_t end = data.find('\0', pos);
+        if (end == std::string::npos) {
+            break;
+        }
+        table.push_back({data.substr(pos, end - pos), freq});
+        pos = end + 1;
+    }
+    return table;
+}
+}
+
+void XapianTopTerms::noteDocument(const Xapian::Document &doc)
+{
+    for (auto it = doc.termlist_begin(), end = doc.termlist_end(); it != end; ++it) {
+        const std::string term = *it;
+        if (!isPrefixed(term)) {
+            m_terms.insert(term);
+        }
+    }
+}
+
+void XapianTopTerms::update(Xapian::WritableDatabase &db)
+{
+    if (db.get_metadata(MarkerKey).empty()) {
+        m_terms.clear();
+        rebuild(db);
+        return;
+    }
+
+    std::map<std::string, Table> changes;
+    for (const std::string &term : std::as_const(m_terms)) {
+        const Xapian::doccount freq = db.get_termfreq(term);
+        for (const std::string &prefix : shortPrefixes(term)) {
+            changes[prefix].push_back({term, freq});
+        }
+    }
+    m_terms.clear();
+
+    for (const auto &[prefix, changed] : changes) {
+        const std::string key = TableKeyPrefix + prefix;
+        Table table = deserialize(db.get_metadata(key));
+        for (const Entry &entry : changed) {
+            const auto it = std::find_if(table.begin(), table.end(), [&entry](const Entry &e) {
+                return e.term == entry.term;
+            });
+            if (it != table.end()) {
+                it->freq = entry.freq;
+            } else {
+                table.push_back(entry);
+            }
+        }
+        table.erase(std::remove_if(table.begin(),
+                                   table.end(),
+                                   [](const Entry &e) {
+                                       return e.freq == 0;
+                                   }),
+                    table.end());
+        trim(table);
+        // An empty value removes the table
+        db.set_metadata(key, serialize(table));
+    }
+}
+
+void XapianTopTerms::rebuild(Xapian::WritableDatabase &db)
+{
+    std::vector<std::string> staleKeys(db.metadata_keys_begin(TableKeyPrefix), db.metadata_keys_end(TableKeyPrefix));
+    for (const std::string &key : staleKeys) {
+        db.set_metadata(key, std::string());
+    }
+
+    // Trimmed whenever a table gets twice as large as needed
+    std::map<std::string, Table> tables;
+    Xapian::TermIterator it = db.allterms_begin();
+    const Xapian::TermIterator end = db.allterms_end();
+    while (it != end) {
+        const std::string term = *it;
+        if (isPrefixed(term)) {
+            // Past all the prefixed terms
+            it.skip_to("[");
+            continue;
+        }
+        const Entry entry{term, it.get_termfreq()};
+        for (const std::string &prefix : shortPrefixes(term)) {
+            Table &table = tables[prefix];
+            table.push_back(entry);
+            if (table.size() >= 2 * static_cast<std::size_t>(MaxTerms)) {
+                trim(table);
+            }
+        }
+        ++it;
+    }
+
+    for (auto &[prefix, table] : tables) {
+        trim(table);
+        db.set_metadata(TableKeyPrefix + prefix, serialize(table));
+    }
+    db.set_metadata(MarkerKey, "1");
+}
+
+std::optional<std::vector<std::string>> XapianTopTerms::read(const Xapian::Database &db, const std::string &prefix)
+{
+    if (prefix.empty() || isPrefixed(prefix) || characterCount(prefix) > MaxPrefixLength) {
+        return std::nullopt;
+    }
+    if (db.get_metadata(MarkerKey).empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<std::string> terms;
+    for (Entry &entry : deserialize(db.get_metadata(TableKeyPrefix + prefix))) {
+        terms.push_back(std::move(entry.term));
+    }
+    return terms;
+}
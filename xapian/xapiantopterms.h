@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ *
+ */
+
+#pragma once
+
+#include "search_xapian_export.h"
+#include <xapian.h>
+
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace Akonadi
+{
+namespace Search
+{
+/*!
+ * The most frequent terms starting with each short prefix, kept in the
+ * metadata of the database.
+ *
+ * Words of a few characters start most of the dictionary, finding their most
+ * frequent completions at query time would mean reading all of it. Writers
+ * note the documents they change and update the tables of the touched
+ * prefixes before committing, readers get them with a metadata lookup.
+ *
+ * Only unprefixed terms, the ones of free text searches, are kept.
+ */
+class AKONADI_SEARCH_XAPIAN_EXPORT XapianTopTerms
+{
+public:
+    /*! The number of terms kept per prefix. */
+    static constexpr int MaxTerms = 100;
+    /*! The longest prefixes with a table, in characters. */
+    static constexpr int MaxPrefixLength = 3;
+
+    /*!
+     * Notes the terms of \a doc, a document which is added, replaced or about
+     * to be deleted.
+     */
+    void noteDocument(const Xapian::Document &doc);
+
+    /*!
+     * Updates the tables of the prefixes of the noted terms, call it before
+     * committing \a db.
+     *
+     * The frequencies of the noted terms are read again, the other terms of
+     * the tables keep theirs until they are noted. When \a db has no tables
+     * yet, they are built from all of its terms.
+     */
+    void update(Xapian::WritableDatabase &db);
+
+    /*!
+     * Returns the most frequent terms starting with \a prefix, the most
+     * frequent first, or nothing when \a db has no table for it.
+     */
+    [[nodiscard]] static std::optional<std::vector<std::string>> read(const Xapian::Database &db, const std::string &prefix);
+
+private:
+    AKONADI_SEARCH_XAPIAN_NO_EXPORT static void rebuild(Xapian::WritableDatabase &db);
+
+    std::set<std::string> m_terms;
+};
+}
+}